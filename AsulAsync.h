@@ -0,0 +1,669 @@
+/*
+    File        : AsulAsync.h
+    Description : Asynchronous output for AsulFormatString
+
+    Copyright (c) 2025 AsulTop
+    MIT License
+*/
+
+#ifndef ASULASYNC_H
+#define ASULASYNC_H
+
+#include "AsulFormatString.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+// Sink that hands every write() to a background thread which forwards it to another sink.
+// Callers copy the text into a bounded lock-free multi-producer ring and return; the
+// writer thread drains the ring in batches. Each write() is one record, so lines produced
+// by print() (one write per call) never interleave.
+//
+//   AsulAsyncSink async(std::make_unique<AsulFormatString::FdSink>(1));
+//   asul_formatter().setPrintSink(&async);
+//   print("(INFO) {}[[ENDL]]", "queued");
+//   async.flush();
+class AsulAsyncSink : public AsulFormatString::Sink {
+public:
+    using AsulFormatString::Sink::write;
+    enum class Overflow {
+        Block,      // wait for room
+        DropNewest, // discard the record being written
+        DropOldest  // discard the oldest queued record to make room
+    };
+    static constexpr size_t defaultCapacity = 8192;
+
+    explicit AsulAsyncSink(std::unique_ptr<AsulFormatString::Sink> target, size_t capacity = defaultCapacity,
+                           Overflow policy = Overflow::Block)
+        : owned(std::move(target)), target(*owned), policy(policy) { start(capacity); }
+    // Forwards to a sink owned by the caller, which must outlive this object
+    explicit AsulAsyncSink(AsulFormatString::Sink &target, size_t capacity = defaultCapacity,
+                           Overflow policy = Overflow::Block)
+        : target(target), policy(policy) { start(capacity); }
+    AsulAsyncSink(const AsulAsyncSink&) = delete;
+    AsulAsyncSink& operator=(const AsulAsyncSink&) = delete;
+
+    // Drains everything that was queued, then stops the writer thread.
+    // Detach it (setPrintSink(nullptr)) before it is destroyed.
+    ~AsulAsyncSink() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        writer.join();
+    }
+
+    void write(const char *data, size_t size) override {
+        if (tryPush(data, size)) {
+            notifyWriter();
+            return;
+        }
+        switch (policy) {
+            case Overflow::DropNewest:
+                droppedRecords.fetch_add(1, std::memory_order_relaxed);
+                return;
+            case Overflow::DropOldest:
+                do {
+                    if (tryPop(nullptr)) {
+                        droppedRecords.fetch_add(1, std::memory_order_relaxed);
+                        droppedOldest.fetch_add(1);
+                    }
+                } while (!tryPush(data, size));
+                break;
+            case Overflow::Block:
+                for (unsigned spins = 0; !tryPush(data, size); ++spins) {
+                    notifyWriter();
+                    if (spins < 64) std::this_thread::yield();
+                    else std::this_thread::sleep_for(std::chrono::microseconds(50));
+                }
+                break;
+        }
+        notifyWriter();
+    }
+
+    // Returns once everything written before the call has reached the target and the
+    // target has been flushed
+    void flush() override {
+        uint64_t ticket = enqueuePos.load(std::memory_order_acquire);
+        flushWaiters.fetch_add(1);
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.notify_one();
+        drained.wait(lock, [&] { return done.load() >= ticket; });
+        flushWaiters.fetch_sub(1);
+    }
+
+    // Records discarded by DropNewest / DropOldest
+    size_t dropped() const { return droppedRecords.load(std::memory_order_relaxed); }
+    size_t capacity() const { return mask + 1; }
+
+private:
+    // Vyukov style bounded queue: a cell is free for position p when seq == p and holds
+    // the record of position p when seq == p + 1. Cells keep their string capacity, so a
+    // warmed up ring does not allocate.
+    struct Cell {
+        std::atomic<uint64_t> seq{0};
+        std::string text;
+    };
+
+    std::unique_ptr<AsulFormatString::Sink> owned;
+    AsulFormatString::Sink &target;
+    Overflow policy;
+    std::unique_ptr<Cell[]> cells;
+    uint64_t mask = 0;
+    alignas(64) std::atomic<uint64_t> enqueuePos{0};
+    alignas(64) std::atomic<uint64_t> dequeuePos{0};
+    alignas(64) std::atomic<uint64_t> done{0}; // records written out or dropped as oldest
+    // Dropped as oldest but not yet in done: they were queued behind the batch the writer
+    // may still be writing, so they count once that batch is out
+    std::atomic<uint64_t> droppedOldest{0};
+    std::atomic<size_t> droppedRecords{0};
+    std::atomic<bool> writerSleeping{false};
+    std::atomic<int> flushWaiters{0};
+    std::mutex mutex;
+    std::condition_variable wake, drained;
+    bool stopping = false;
+    std::thread writer;
+
+    void start(size_t capacity) {
+        size_t n = 2;
+        while (n < capacity) n *= 2;
+        mask = n - 1;
+        cells.reset(new Cell[n]);
+        for (size_t i = 0; i < n; ++i) cells[i].seq.store(i, std::memory_order_relaxed);
+        writer = std::thread([this] { run(); });
+    }
+
+    bool tryPush(const char *data, size_t size) {
+        uint64_t pos = enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = cells[pos & mask];
+            uint64_t seq = cell.seq.load(std::memory_order_acquire);
+            int64_t diff = static_cast<int64_t>(seq - pos);
+            if (diff == 0) {
+                // seq_cst: pairs with the writer's sleep check, see run()
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1)) {
+                    cell.text.assign(data, size);
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Takes the oldest record; its text is swapped into out, or dropped when out is null
+    bool tryPop(std::string *out) {
+        uint64_t pos = dequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = cells[pos & mask];
+            uint64_t seq = cell.seq.load(std::memory_order_acquire);
+            int64_t diff = static_cast<int64_t>(seq - (pos + 1));
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    if (out) out->swap(cell.text);
+                    cell.seq.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // empty
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void notifyWriter() {
+        if (writerSleeping.load()) {
+            std::lock_guard<std::mutex> lock(mutex);
+            wake.notify_one();
+        }
+    }
+
+    void finished(uint64_t n) {
+        done.fetch_add(n);
+        if (flushWaiters.load() > 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            drained.notify_all();
+        }
+    }
+
+    void run() {
+        static constexpr size_t batchBytes = 64 * 1024;
+        std::string batch, record;
+        batch.reserve(batchBytes);
+        for (;;) {
+            uint64_t n = 0;
+            while (batch.size() < batchBytes && tryPop(&record)) {
+                batch += record;
+                ++n;
+            }
+            if (n) {
+                target.write(batch);
+                batch.clear();
+                if (batch.capacity() > 4 * batchBytes) batch.shrink_to_fit();
+                if (flushWaiters.load() > 0 || dequeuePos.load(std::memory_order_relaxed) == enqueuePos.load(std::memory_order_relaxed)) {
+                    target.flush();
+                }
+                finished(n + droppedOldest.exchange(0));
+                continue;
+            }
+            // Either a producer's claim of a cell is ordered before this check, or its later
+            // writerSleeping load sees true and it notifies under the mutex.
+            std::unique_lock<std::mutex> lock(mutex);
+            writerSleeping.store(true);
+            if (enqueuePos.load() == dequeuePos.load(std::memory_order_relaxed)) {
+                if (stopping) break;
+                wake.wait_for(lock, std::chrono::milliseconds(100));
+            } else {
+                // a producer claimed a cell but has not published it yet
+                lock.unlock();
+                std::this_thread::yield();
+            }
+            writerSleeping.store(false);
+        }
+        target.flush();
+    }
+};
+
+// Specialize to let AsulDeferredLogger carry a user type as bytes instead of formatting
+// the whole record on the calling thread:
+//   template <> struct AsulDeferredCodec<Point> {
+//       static size_t size(const Point &p);
+//       static void encode(const Point &p, char *dst);   // writes size(p) bytes
+//       static Point decode(const char *src);
+//   };
+// The decoded value is what print() receives, so operator<< and installTypedFuncAdapter work.
+template <typename T>
+struct AsulDeferredCodec;
+
+// Specialize as std::true_type for a trivially copyable type that holds no pointers
+// (a struct of numbers) to have AsulDeferredLogger copy it as bytes. Not done by default:
+// a struct holding a const char* or string_view would be read on the writer thread after
+// the text it points to is gone.
+template <typename T>
+struct AsulDeferredRaw : std::false_type {};
+
+// NanoLog style logging: the calling thread only copies a format id and the raw argument
+// bytes into its own buffer; a background thread decodes them and runs the normal print()
+// engine into the target sink.
+//
+//   AsulDeferredLogger log(sink);
+//   log.log(AFS_FMT("(INFO) {} took {} ms[[ENDL]]"), id, ms);   // format id, no copy
+//   log.log("(INFO) {}[[ENDL]]", name);                        // format text copied
+//
+// Numbers, enums and AsulDeferredRaw types are copied as bytes, strings are copied,
+// AsulDeferredLogger::literal("...") is passed as a pointer. A record with any other
+// argument type is formatted on the calling thread and queued as text.
+// Records of one thread keep their order; records of different threads may interleave.
+// Adapters are looked up when the record is rendered, not when it is logged.
+class AsulDeferredLogger {
+public:
+    enum class Overflow {
+        Block,     // wait for the writer to free space
+        DropNewest // discard the record being logged
+    };
+    static constexpr size_t defaultBufferBytes = 1 << 20;
+
+    // A string with static storage duration, passed by pointer
+    struct Literal {
+        const char *text;
+        friend std::ostream &operator<<(std::ostream &os, Literal l) { return os << l.text; }
+    };
+    static Literal literal(const char *text) { return Literal{text}; }
+
+    explicit AsulDeferredLogger(AsulFormatString::Sink &target, AsulFormatString &afs = asul_formatter(),
+                                size_t bufferBytes = defaultBufferBytes, Overflow policy = Overflow::Block)
+        : target(target), afs(afs), policy(policy) {
+        size_t n = 64;
+        while (n < bufferBytes) n *= 2;
+        bufferSize = n;
+        writer = std::thread([this] { run(); });
+    }
+    AsulDeferredLogger(const AsulDeferredLogger&) = delete;
+    AsulDeferredLogger& operator=(const AsulDeferredLogger&) = delete;
+
+    // Renders everything logged so far, then stops the writer thread
+    ~AsulDeferredLogger() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        writer.join();
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        for (auto &b : buffers) b->closed.store(true, std::memory_order_release);
+    }
+
+    template <typename... Args>
+    void log(std::string_view fmt, const Args&... args) {
+        if constexpr ((deferrable<Args>() && ...)) {
+            size_t size = sizeof(uint32_t) + fmt.size() + (wireSize(args) + ... + 0);
+            ThreadBuffer &b = threadBuffer();
+            char *p = reserve(b, size, &renderDynamic<Decoded<Args>...>);
+            if (!p) return;
+            uint32_t n = static_cast<uint32_t>(fmt.size());
+            std::memcpy(p, &n, sizeof n);
+            std::memcpy(p + sizeof n, fmt.data(), fmt.size());
+            p += sizeof n + fmt.size();
+            (encode(args, p), ...);
+            commit(b);
+        } else {
+            logText(afs.f(fmt, args...));
+        }
+    }
+    template <typename Fmt, typename... Args, typename = std::enable_if_t<std::is_base_of_v<AsulFormatString::StaticFormatTag, Fmt> > >
+    void log(Fmt fmt, const Args&... args) {
+        if constexpr ((deferrable<Args>() && ...)) {
+            ThreadBuffer &b = threadBuffer();
+            char *p = reserve(b, (wireSize(args) + ... + 0), &renderStatic<Fmt, Decoded<Args>...>);
+            if (!p) return;
+            (encode(args, p), ...);
+            commit(b);
+        } else {
+            logText(afs.f(fmt, args...));
+        }
+    }
+
+    // Returns once every record logged before the call has been written and the target flushed
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex);
+        uint64_t ticket = ++flushRequested;
+        wake.notify_one();
+        drained.wait(lock, [&] { return flushCompleted >= ticket; });
+    }
+
+    // Records discarded by DropNewest or because they were larger than a thread buffer
+    size_t dropped() const { return droppedRecords.load(std::memory_order_relaxed); }
+
+private:
+    using Renderer = AsulFormatString::FormatIssue (*)(const char *payload, AsulFormatString &afs, AsulFormatString::Sink &out);
+    struct RecordHeader {
+        uint32_t size;     // header + payload, rounded up to 8
+        Renderer render;   // null: skip to the start of the buffer
+    };
+
+    // Single producer (the owning thread), single consumer (the writer thread)
+    struct ThreadBuffer {
+        explicit ThreadBuffer(size_t size) : data(new char[size]), size(size) {}
+        std::unique_ptr<char[]> data;
+        size_t size;
+        alignas(64) std::atomic<size_t> head{0};  // bytes published by the producer
+        alignas(64) std::atomic<size_t> tail{0};  // bytes consumed by the writer
+        size_t pending = 0;                       // head of the record being written
+        std::atomic<bool> retired{false};         // owning thread exited
+        std::atomic<bool> closed{false};          // logger destroyed
+    };
+    // The buffers a thread logs into, one per logger
+    struct ThreadBuffers {
+        std::vector<std::pair<uint64_t, std::shared_ptr<ThreadBuffer> > > list;
+        ~ThreadBuffers() {
+            for (auto &e : list) e.second->retired.store(true, std::memory_order_release);
+        }
+    };
+
+    AsulFormatString::Sink &target;
+    AsulFormatString &afs;
+    Overflow policy;
+    size_t bufferSize = 0;
+    const uint64_t id = nextLoggerId();
+    std::atomic<size_t> droppedRecords{0};
+
+    std::mutex buffersMutex;
+    std::vector<std::shared_ptr<ThreadBuffer> > buffers;
+    std::atomic<uint64_t> buffersVersion{0};
+
+    std::mutex mutex;
+    std::condition_variable wake, drained;
+    bool stopping = false;
+    uint64_t flushRequested = 0, flushCompleted = 0; // a pass that starts after a request covers it
+    std::thread writer;
+
+    static uint64_t nextLoggerId() {
+        static std::atomic<uint64_t> counter{0};
+        return ++counter;
+    }
+
+    template <typename T, typename = void>
+    struct HasCodec : std::false_type {};
+    template <typename T>
+    struct HasCodec<T, std::void_t<decltype(AsulDeferredCodec<T>::decode(static_cast<const char*>(nullptr)))> > : std::true_type {};
+
+    enum class Wire { Raw, String, Borrowed, User, None };
+    template <typename T>
+    static constexpr Wire wireOf() {
+        using D = std::decay_t<T>;
+        if constexpr (HasCodec<D>::value) return Wire::User;
+        else if constexpr (std::is_same_v<D, std::string> || std::is_same_v<D, std::string_view> ||
+                           std::is_same_v<D, const char*> || std::is_same_v<D, char*>) return Wire::String;
+        else if constexpr (std::is_same_v<D, Literal>) return Wire::Borrowed;
+        else if constexpr (std::is_arithmetic_v<D> || std::is_enum_v<D>) return Wire::Raw;
+        else if constexpr (AsulDeferredRaw<D>::value) {
+            static_assert(std::is_trivially_copyable_v<D>, "AsulDeferredRaw<T> needs a trivially copyable T");
+            return Wire::Raw;
+        } else {
+            return Wire::None;
+        }
+    }
+    template <typename T>
+    static constexpr bool deferrable() { return wireOf<T>() != Wire::None; }
+
+    // Type handed to print() on the writer thread
+    template <typename T, Wire W = wireOf<T>()>
+    struct DecodedType { using type = std::decay_t<T>; };
+    template <typename T>
+    struct DecodedType<T, Wire::String> { using type = std::string; };
+    template <typename T>
+    struct DecodedType<T, Wire::Borrowed> { using type = const char*; };
+    template <typename T>
+    using Decoded = typename DecodedType<T>::type;
+
+    template <typename T>
+    static size_t wireSize(const T &v) {
+        using D = std::decay_t<T>;
+        constexpr Wire w = wireOf<T>();
+        if constexpr (w == Wire::User) return AsulDeferredCodec<D>::size(v);
+        else if constexpr (w == Wire::String) return sizeof(uint32_t) + stringView(v).size();
+        else if constexpr (w == Wire::Borrowed) return sizeof(const char*);
+        else return sizeof(D);
+    }
+    template <typename T>
+    static void encode(const T &v, char *&p) {
+        using D = std::decay_t<T>;
+        constexpr Wire w = wireOf<T>();
+        if constexpr (w == Wire::User) {
+            AsulDeferredCodec<D>::encode(v, p);
+            p += AsulDeferredCodec<D>::size(v);
+        } else if constexpr (w == Wire::String) {
+            std::string_view sv = stringView(v);
+            uint32_t n = static_cast<uint32_t>(sv.size());
+            std::memcpy(p, &n, sizeof n);
+            std::memcpy(p + sizeof n, sv.data(), sv.size());
+            p += sizeof n + sv.size();
+        } else if constexpr (w == Wire::Borrowed) {
+            const char *text = v.text;
+            std::memcpy(p, &text, sizeof text);
+            p += sizeof text;
+        } else {
+            std::memcpy(p, &v, sizeof(D));
+            p += sizeof(D);
+        }
+    }
+    template <typename D>
+    static D decode(const char *&p) {
+        if constexpr (HasCodec<D>::value) {
+            D v = AsulDeferredCodec<D>::decode(p);
+            p += AsulDeferredCodec<D>::size(v);
+            return v;
+        } else if constexpr (std::is_same_v<D, std::string>) {
+            uint32_t n;
+            std::memcpy(&n, p, sizeof n);
+            std::string v(p + sizeof n, n);
+            p += sizeof n + n;
+            return v;
+        } else {
+            // raw bytes, D need not be default constructible; Literal arrives as its pointer
+            alignas(D) unsigned char raw[sizeof(D)];
+            std::memcpy(raw, static_cast<const void*>(p), sizeof(D));
+            p += sizeof(D);
+            return *reinterpret_cast<const D*>(raw);
+        }
+    }
+    static std::string_view stringView(const std::string &s) { return s; }
+    static std::string_view stringView(std::string_view s) { return s; }
+    static std::string_view stringView(const char *s) { return s ? std::string_view(s) : std::string_view(); }
+
+    template <typename... Ds>
+    static AsulFormatString::FormatIssue renderDynamic(const char *p, AsulFormatString &afs, AsulFormatString::Sink &out) {
+        uint32_t n;
+        std::memcpy(&n, p, sizeof n);
+        std::string_view fmt(p + sizeof n, n);
+        p += sizeof n + n;
+        std::tuple<Ds...> args{decode<Ds>(p)...}; // braced init: decoded left to right
+        return std::apply([&](const Ds&... a) { return afs.try_print(out, fmt, a...); }, args);
+    }
+    template <typename Fmt, typename... Ds>
+    static AsulFormatString::FormatIssue renderStatic(const char *p, AsulFormatString &afs, AsulFormatString::Sink &out) {
+        std::tuple<Ds...> args{decode<Ds>(p)...};
+        return std::apply([&](const Ds&... a) { return afs.try_print(out, Fmt{}, a...); }, args);
+    }
+    static AsulFormatString::FormatIssue renderText(const char *p, AsulFormatString &, AsulFormatString::Sink &out) {
+        uint32_t n;
+        std::memcpy(&n, p, sizeof n);
+        out.write(p + sizeof n, n);
+        return AsulFormatString::FormatIssue();
+    }
+
+    void logText(const std::string &text) {
+        ThreadBuffer &b = threadBuffer();
+        char *p = reserve(b, sizeof(uint32_t) + text.size(), &renderText);
+        if (!p) return;
+        uint32_t n = static_cast<uint32_t>(text.size());
+        std::memcpy(p, &n, sizeof n);
+        std::memcpy(p + sizeof n, text.data(), text.size());
+        commit(b);
+    }
+
+    ThreadBuffer &threadBuffer() {
+        thread_local ThreadBuffers mine;
+        for (auto &e : mine.list) {
+            if (e.first == id) return *e.second;
+        }
+        // forget buffers of loggers that are gone
+        mine.list.erase(std::remove_if(mine.list.begin(), mine.list.end(), [](const auto &e) {
+            return e.second->closed.load(std::memory_order_acquire);
+        }), mine.list.end());
+        auto b = std::make_shared<ThreadBuffer>(bufferSize);
+        {
+            std::lock_guard<std::mutex> lock(buffersMutex);
+            buffers.push_back(b);
+            buffersVersion.fetch_add(1, std::memory_order_release);
+        }
+        mine.list.emplace_back(id, b);
+        return *b;
+    }
+
+    // Space for one record of payloadSize bytes in the calling thread's buffer, or null when
+    // it was dropped. The record becomes visible to the writer on commit().
+    char *reserve(ThreadBuffer &b, size_t payloadSize, Renderer render) {
+        size_t size = (sizeof(RecordHeader) + payloadSize + 7) & ~size_t(7);
+        if (size > b.size / 2 || size > UINT32_MAX) {
+            droppedRecords.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        size_t head = b.head.load(std::memory_order_relaxed);
+        size_t offset = head & (b.size - 1);
+        size_t skip = b.size - offset < size ? b.size - offset : 0; // records never wrap
+        for (unsigned spins = 0; head + skip + size - b.tail.load(std::memory_order_acquire) > b.size; ++spins) {
+            if (policy == Overflow::DropNewest) {
+                droppedRecords.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            if (spins == 0) wake.notify_one();
+            if (spins < 64) std::this_thread::yield();
+            else std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        if (skip >= sizeof(RecordHeader)) {
+            RecordHeader wrap{static_cast<uint32_t>(skip), nullptr};
+            std::memcpy(b.data.get() + offset, &wrap, sizeof wrap);
+        }
+        head += skip;
+        RecordHeader h{static_cast<uint32_t>(size), render};
+        std::memcpy(b.data.get() + (head & (b.size - 1)), &h, sizeof h);
+        b.pending = head + size;
+        return b.data.get() + (head & (b.size - 1)) + sizeof h;
+    }
+    static void commit(ThreadBuffer &b) {
+        b.head.store(b.pending, std::memory_order_release);
+    }
+
+    // Renders what one buffer holds, returns the number of records
+    size_t drain(ThreadBuffer &b, std::string &batch) {
+        size_t head = b.head.load(std::memory_order_acquire);
+        size_t tail = b.tail.load(std::memory_order_relaxed);
+        size_t n = 0;
+        AsulFormatString::StringSink out(batch);
+        while (tail != head) {
+            size_t offset = tail & (b.size - 1);
+            if (b.size - offset < sizeof(RecordHeader)) {
+                tail += b.size - offset;
+                continue;
+            }
+            RecordHeader h;
+            std::memcpy(&h, b.data.get() + offset, sizeof h);
+            if (h.render) {
+                size_t mark = batch.size();
+                AsulFormatString::FormatIssue issue;
+#ifdef ASUL_FORMAT_STRING_EXCEPTIONS
+                try {
+                    issue = h.render(b.data.get() + offset + sizeof h, afs, out);
+                } catch (const std::exception &e) {
+                    issue.message = e.what(); // thrown by a funcAdapter
+                }
+#else
+                issue = h.render(b.data.get() + offset + sizeof h, afs, out);
+#endif
+                if (!issue.ok()) {
+                    batch.resize(mark);
+                    batch += "<AsulDeferredLogger: ";
+                    batch += issue.message;
+                    batch += ">\n";
+                }
+                ++n;
+            }
+            tail += h.size;
+            b.tail.store(tail, std::memory_order_release);
+            if (batch.size() >= 64 * 1024) {
+                target.write(batch);
+                batch.clear();
+            }
+        }
+        return n;
+    }
+
+    void run() {
+        std::vector<std::shared_ptr<ThreadBuffer> > local;
+        uint64_t seenVersion = 0;
+        std::string batch;
+        for (;;) {
+            uint64_t ticket;
+            bool stop;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ticket = flushRequested;
+                stop = stopping;
+            }
+            uint64_t version = buffersVersion.load(std::memory_order_acquire);
+            if (version != seenVersion) {
+                std::lock_guard<std::mutex> lock(buffersMutex);
+                local = buffers;
+                seenVersion = buffersVersion.load(std::memory_order_relaxed);
+            }
+            size_t n = 0;
+            for (auto &b : local) n += drain(*b, batch);
+            if (!batch.empty()) {
+                target.write(batch);
+                batch.clear();
+            }
+            // buffers of exited threads go away once empty
+            bool pruned = false;
+            for (auto &b : local) {
+                if (b->retired.load(std::memory_order_acquire) && b->tail.load(std::memory_order_relaxed) == b->head.load(std::memory_order_acquire)) {
+                    pruned = true;
+                }
+            }
+            if (pruned) {
+                std::lock_guard<std::mutex> lock(buffersMutex);
+                buffers.erase(std::remove_if(buffers.begin(), buffers.end(), [](const std::shared_ptr<ThreadBuffer> &b) {
+                    return b->retired.load(std::memory_order_acquire) && b->tail.load(std::memory_order_relaxed) == b->head.load(std::memory_order_acquire);
+                }), buffers.end());
+                buffersVersion.fetch_add(1, std::memory_order_release);
+            }
+
+            if (n || ticket != flushCompleted) target.flush();
+            std::unique_lock<std::mutex> lock(mutex);
+            if (ticket != flushCompleted) {
+                flushCompleted = ticket;
+                drained.notify_all();
+            }
+            if (stop && n == 0) break;
+            if (n == 0 && flushRequested == flushCompleted) wake.wait_for(lock, std::chrono::milliseconds(5));
+        }
+        target.flush();
+    }
+};
+
+#endif // ASULASYNC_H
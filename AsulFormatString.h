@@ -37,113 +37,175 @@
 #include <unordered_map>
 #include <functional>
 #include <iomanip>
-#include <regex>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <sstream>
-#include <stack>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <variant>
+#include <algorithm>
 #include <any>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <cstdint>
+#include <exception>
+#include <thread>
+#include <tuple>
 #include <type_traits>
 #include <vector>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ASUL_FORMAT_STRING_SSE2
+#if defined(__GNUC__)
+#include <immintrin.h>
+#define ASUL_FORMAT_STRING_AVX2 // compiled with target("avx2"), used when the CPU has it
+#endif
+#endif
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#define ASUL_FORMAT_STRING_EXCEPTIONS // otherwise f() / print() abort where they would throw
+#endif
 #include "Color256.h"
+class AsulFormatString;
+// Formatting for your own argument types. Specialize it with
+//     void format(const T &value, AsulFormatString::Sink &out) const;
+// and {} writes the value straight into the output: picked at compile time, ahead of
+// operator<< and std::any, so no heap copy, no RTTI and no exceptions are involved.
+template <typename T, typename Enable = void>
+struct AsulFormatter {};
+
 class AsulFormatString {
 public:
     using VariantType = std::variant<int, double, std::string, bool, char, std::any>;
     using AdapterMap = std::unordered_map<std::string, std::string>;
     using FuncMap = std::unordered_map<std::string, std::function<std::string(const VariantType &)> >;
+    // Whether an argument is the type installTypedFuncAdapter<T> was given
+    using FuncTypeCheck = std::function<bool(const VariantType &)>;
     
     static std::string variantToString(const VariantType& v) {
-        std::ostringstream oss;
-        if (std::holds_alternative<int>(v)) oss << std::get<int>(v);
-        else if (std::holds_alternative<double>(v)) oss << std::get<double>(v);
-        else if (std::holds_alternative<std::string>(v)) oss << std::get<std::string>(v);
-        else if (std::holds_alternative<bool>(v)) oss << (std::get<bool>(v) ? "true" : "false");
-        else if (std::holds_alternative<char>(v)) oss << std::get<char>(v);
-        else if (std::holds_alternative<std::any>(v)) {
-            const std::any &a = std::get<std::any>(v);
-            if (!a.has_value()) {
-                oss << "<empty any>";
-            } else {
-                try { oss << std::any_cast<std::string>(a); }
-                catch (const std::bad_any_cast&) {
-                    try { oss << std::any_cast<const char*>(a); }
-                    catch (const std::bad_any_cast&) {
-                        oss << "<any:" << a.type().name() << ">";
-                    }
-                }
-            }
+        char buf[32];
+        if (std::holds_alternative<int>(v)) return std::string(buf, std::to_chars(buf, buf + sizeof buf, std::get<int>(v)).ptr);
+        if (std::holds_alternative<double>(v)) {
+            // same text as an ostream with default flags: %g, 6 significant digits
+            return std::string(buf, std::to_chars(buf, buf + sizeof buf, std::get<double>(v), std::chars_format::general, 6).ptr);
         }
-        return oss.str();
+        if (std::holds_alternative<std::string>(v)) return std::get<std::string>(v);
+        if (std::holds_alternative<bool>(v)) return std::get<bool>(v) ? "true" : "false";
+        if (std::holds_alternative<char>(v)) return std::string(1, std::get<char>(v));
+        const std::any &a = std::get<std::any>(v);
+        if (!a.has_value()) return "<empty any>";
+        if (const std::string *str = std::any_cast<std::string>(&a)) return *str;
+        if (const char *const *str = std::any_cast<const char*>(&a)) return *str ? *str : "";
+#if defined(__cpp_rtti) || defined(__GXX_RTTI) || defined(_CPPRTTI)
+        return std::string("<any:") + a.type().name() + ">";
+#else
+        return "<any>";
+#endif
     }
     AsulFormatString() = default;
+    AsulFormatString(const AsulFormatString&) = delete;
+    AsulFormatString& operator=(const AsulFormatString&) = delete;
+
+    // install*/clear* copy the current registry, change the copy and publish it; formatting
+    // threads keep using their snapshot until they see the new generation
     void installFuncFormatAdapter(const FuncMap& mp) {
-        for (const auto& [key, value] : mp) {
-            auto it = funcAdapter.find(key);
-            if (it != funcAdapter.end()) {
-                #ifdef ALLOW_DEBUG_ASULFORMATSTRING
-                print("(({YELLOW}) [[LEFT]][[SETW:40]]{} already exists in funcAdapter. New: [[LEFT]][[SETW:40]]{}[[ENDL]]", "Debug",f("{UNDERLINE}={}",key,"<existing function>"),f("{UNDERLINE}={}",key,"<new function>"));
-                #endif
-                it->second = value;
-            } else {
-                funcAdapter.emplace(key, value);
+        updateRegistry([&](Registry &reg) {
+            for (const auto& [key, value] : mp) {
+                auto it = reg.funcAdapter.find(key);
+                if (it != reg.funcAdapter.end()) {
+                    #ifdef ALLOW_DEBUG_ASULFORMATSTRING
+                    print("(({YELLOW}) [[LEFT]][[SETW:40]]{} already exists in funcAdapter. New: [[LEFT]][[SETW:40]]{}[[ENDL]]", "Debug",f("{UNDERLINE}={}",key,"<existing function>"),f("{UNDERLINE}={}",key,"<new function>"));
+                    #endif
+                    it->second = value;
+                } else {
+                    reg.funcAdapter.emplace(key, value);
+                }
+                reg.funcTypes.erase(key);
             }
-        }
+        });
+    }
+    void clearFuncFormatAdapter() {
+        updateRegistry([](Registry &reg) {
+            reg.funcAdapter.clear();
+            reg.funcTypes.clear();
+        });
     }
-    void clearFuncFormatAdapter() { funcAdapter.clear(); }
 
+    // A {key} argument that is not a T is a FormatIssue::Type problem: f() / print() throw
+    // it, try_f() / try_print() return it, fn is not called
     template <typename T, typename Fn>
     void installTypedFuncAdapter(const std::string &key, Fn fn) {
-        funcAdapter[key] = [fn, key](const VariantType &v) -> std::string {
+        FuncTypeCheck accepts = [](const VariantType &v) {
+            return std::visit([](auto&& arg) {
+                using U = std::decay_t<decltype(arg)>;
+                if constexpr (std::is_same_v<U, std::any>) return std::any_cast<T>(&arg) != nullptr;
+                else return std::is_same_v<U, T>;
+            }, v);
+        };
+        FuncMap::mapped_type typed = [fn](const VariantType &v) -> std::string {
             return std::visit([&](auto&& arg) -> std::string {
                 using U = std::decay_t<decltype(arg)>;
                 if constexpr (std::is_same_v<U, std::any>) {
-                    try {
-                        const T &t = std::any_cast<const T&>(arg);
-                        return fn(t);
-                    } catch (const std::bad_any_cast&) {
-                        throw std::invalid_argument("Type mismatch for funcAdapter '" + key + "': bad any_cast");
-                    }
-                } else {
-                    if constexpr (std::is_same_v<U, T>) {
-                        return fn(arg);
-                    } else {
-                        throw std::invalid_argument("Type mismatch for funcAdapter '" + key + "'");
-                    }
+                    if (const T *t = std::any_cast<T>(&arg)) return fn(*t);
+                } else if constexpr (std::is_same_v<U, T>) {
+                    return fn(arg);
                 }
+                return std::string(); // only reached when called outside a format, after accepts() said no
             }, v);
         };
+        updateRegistry([&](Registry &reg) {
+            reg.funcAdapter[key] = std::move(typed);
+            reg.funcTypes[key] = std::move(accepts);
+        });
     }
 
     void installFormatAdapter(const AdapterMap& mp) {
-        for (const auto& [key, value] : mp) {
-            auto it = formatAdapter.find(key);
-            if (it != formatAdapter.end()) {
-                #ifdef ALLOW_DEBUG_ASULFORMATSTRING
-                print("(({YELLOW}) [[LEFT]][[SETW:40]]{} already exists in formatAdapter. New: [[LEFT]][[SETW:40]]{}[[ENDL]]", "Debug",f("{UNDERLINE}={}",key,it->second),f("{UNDERLINE}={}",key,value));
-                #endif
-                it->second = value;
-            } else {
-                formatAdapter.emplace(key, value);
+        updateRegistry([&](Registry &reg) {
+            for (const auto& [key, value] : mp) {
+                auto it = reg.formatAdapter.find(key);
+                if (it != reg.formatAdapter.end()) {
+                    #ifdef ALLOW_DEBUG_ASULFORMATSTRING
+                    print("(({YELLOW}) [[LEFT]][[SETW:40]]{} already exists in formatAdapter. New: [[LEFT]][[SETW:40]]{}[[ENDL]]", "Debug",f("{UNDERLINE}={}",key,it->second),f("{UNDERLINE}={}",key,value));
+                    #endif
+                    it->second = value;
+                } else {
+                    reg.formatAdapter.emplace(key, value);
+                }
             }
-        }
+        });
     }
-    void clearFormatAdapter() { formatAdapter.clear(); }
+    void clearFormatAdapter() { updateRegistry([](Registry &reg) { reg.formatAdapter.clear(); }); }
 
     void installLabelAdapter(const AdapterMap& mp) {
-        AdapterMap tempAdapter = mp;
-        for(const auto& [key, value] : mp){
-            if(labelAdapter.find(key) != labelAdapter.end()){
-                #ifdef ALLOW_DEBUG_ASULFORMATSTRING
-                print("(({YELLOW}) [[LEFT]][[SETW:40]]{} already exists in labelAdapter. New: [[LEFT]][[SETW:40]]{}[[ENDL]]", "Debug",f("{UNDERLINE}={}",key,labelAdapter[key]),f("{UNDERLINE}={}",key,value));
-                #endif
-                labelAdapter[key]=value;
+        updateRegistry([&](Registry &reg) {
+            AdapterMap tempAdapter = mp;
+            for(const auto& [key, value] : mp){
+                if(reg.labelAdapter.find(key) != reg.labelAdapter.end()){
+                    #ifdef ALLOW_DEBUG_ASULFORMATSTRING
+                    print("(({YELLOW}) [[LEFT]][[SETW:40]]{} already exists in labelAdapter. New: [[LEFT]][[SETW:40]]{}[[ENDL]]", "Debug",f("{UNDERLINE}={}",key,reg.labelAdapter[key]),f("{UNDERLINE}={}",key,value));
+                    #endif
+                    reg.labelAdapter[key]=value;
+                }
+                else tempAdapter.insert({key,value});
             }
-            else tempAdapter.insert({key,value});
-        }
-        labelAdapter.insert(tempAdapter.begin(), tempAdapter.end());
+            reg.labelAdapter.insert(tempAdapter.begin(), tempAdapter.end());
+        });
     }
-    void clearLabelAdapter() { labelAdapter.clear(); }
+    void clearLabelAdapter() { updateRegistry([](Registry &reg) { reg.labelAdapter.clear(); }); }
 
     //color
     void installColorFormatAdapter() {
@@ -199,495 +261,2776 @@ public:
             {"ASK_N",f("(Y/{UNDERLINE})","N")}
         });
     }
-    // AsulFormatString
-    AsulFormatString* f(std::string ansi256, std::string ansiBackground256) {
-        ANSI256 = ansi256;
-        ANSIBackground256 = ansiBackground256;
-        return this;
-    }
 
-    template <typename... Args>
-    std::string f(std::string fmt, const Args&... args) {
-        std::vector<VariantType> argsVec;
-        argvs_helper(argsVec, args...);
-        
-        if (!hasValidParentheses(fmt)) { 
-            ANSI256 = "";
-            ANSIBackground256 = "";
-            throw std::invalid_argument("Mismatched parentheses in format string");
-        } 
-        if (!hasValidCurlyBraces(fmt)) {
-            ANSI256 = "";
-            ANSIBackground256 = "";
-            throw std::invalid_argument("Mismatched curly braces in format string");
-        }
-        if (!hasValidSquareBrackets(fmt)) {
-            ANSI256 = "";
-            ANSIBackground256 = "";
-            throw std::invalid_argument("Mismatched square brackets in format string");
-        }
-
-        std::string tempFmt = processLabelAdapter(fmt);
-        std::string processedFmt = processAdapter(tempFmt);
-        std::string result;
-        size_t argIndex = 0, i = 0, len = processedFmt.length();
-        while (i < len) {
-            if (processedFmt[i] == '{') {
-                if (i + 1 < len && processedFmt[i + 1] == '{') {
-                    result += '{';
-                    i += 2;
-                    continue;
-                }
-            }
-            if (processedFmt[i] == '(') {
-                if (i + 1 < len && processedFmt[i + 1] == '(') {
-                    result += '(';
-                    i += 2;
-                    continue;
-                }
+    // Output targets of the formatting engine
+    class Sink {
+    public:
+        virtual ~Sink() = default;
+        virtual void write(const char *data, size_t size) = 0;
+        virtual void flush() {}
+        void write(std::string_view s) { write(s.data(), s.size()); }
+    };
+    // Appends to a caller owned std::string
+    class StringSink : public Sink {
+    public:
+        using Sink::write;
+        explicit StringSink(std::string &out) : out(out) {}
+        void write(const char *data, size_t size) override { out.append(data, size); }
+    private:
+        std::string &out;
+    };
+    // Fills a caller owned buffer and drops what does not fit; needed() keeps counting
+    class FixedBufferSink : public Sink {
+    public:
+        using Sink::write;
+        FixedBufferSink(char *buf, size_t capacity) : buf(buf), capacity(capacity) {}
+        void write(const char *data, size_t size) override {
+            if (written < capacity) {
+                size_t n = std::min(size, capacity - written);
+                std::memcpy(buf + written, data, n);
+                written += n;
             }
-
-            if (processedFmt[i] == '{') {
-                size_t j = processedFmt.find('}', i);
-                if (j == std::string::npos) throw std::invalid_argument("Unclosed curly brace in format string");
-                std::string placeholder = processedFmt.substr(i + 1, j - i - 1);
-                if (placeholder.empty()) {
-                    if (argIndex < argsVec.size()) {
-                        result += variantToString(argsVec[argIndex]);
-                        argIndex++;
-                    } else {
-                        result += "{}";
-                    }
-                } else {
-                    auto itF = funcAdapter.find(placeholder);
-                    if (itF != funcAdapter.end()) {
-                        if (argIndex < argsVec.size()) {
-                            result += itF->second(argsVec[argIndex]);
-                            ++argIndex;
-                        } else {
-                            throw std::invalid_argument(std::string("Not enough arguments for function format '{") + placeholder + "}'");
-                        }
-                    } else {
-                        result += processedFmt.substr(i, j - i + 1);
-                    }
+            total += size;
+        }
+        size_t size() const { return written; }
+        size_t needed() const { return total; }
+        bool truncated() const { return total > written; }
+    private:
+        char *buf;
+        size_t capacity;
+        size_t written = 0, total = 0;
+    };
+    // Write errors are left in the stream's error indicator, see failed()
+    class FileSink : public Sink {
+    public:
+        using Sink::write;
+        explicit FileSink(std::FILE *fp) : fp(fp) {}
+        void write(const char *data, size_t size) override { std::fwrite(data, 1, size, fp); }
+        void flush() override { std::fflush(fp); }
+        bool failed() const { return std::ferror(fp) != 0; }
+    private:
+        std::FILE *fp;
+    };
+    // Unbuffered writes to a raw file descriptor. A failed write drops the rest of that
+    // write and keeps its errno for error()
+    class FdSink : public Sink {
+    public:
+        using Sink::write;
+        explicit FdSink(int fd) : fd(fd) {}
+        void write(const char *data, size_t size) override {
+            while (size > 0) {
+#ifdef _WIN32
+                int n = ::_write(fd, data, static_cast<unsigned int>(size));
+#else
+                ssize_t n = ::write(fd, data, size);
+                if (n < 0 && errno == EINTR) continue;
+#endif
+                if (n <= 0) {
+                    err = n < 0 ? errno : EIO;
+                    return;
                 }
-                i = j + 1;
-            } else {
-                result += processedFmt[i];
-                i++;
+                data += n;
+                size -= static_cast<size_t>(n);
             }
         }
-        ANSI256 = "";
-        ANSIBackground256 = "";
-        return result;
-    }
-    void print(const std::string& fmt) {
-        print(fmt,"");
-    }
-    template <typename... Args>
-    void print(const std::string& fmt, const Args&... args) {
-        std::vector<VariantType> argsVec;
-        argvs_helper(argsVec, args...);
-
-        if (!hasValidParentheses(fmt)) {
-            ANSI256 = "";
-            ANSIBackground256 = "";
-            throw std::invalid_argument("Mismatched parentheses in format string");
-        }
-        if (!hasValidCurlyBraces(fmt)) {
-            ANSI256 = "";
-            ANSIBackground256 = "";
-            throw std::invalid_argument("Mismatched curly braces in format string");
-        }
-        if (!hasValidSquareBrackets(fmt)) {
-            ANSI256 = "";
-            ANSIBackground256 = "";
-            throw std::invalid_argument("Mismatched square brackets in format string");
+        bool failed() const { return err != 0; }
+        int error() const { return err; } // errno of the last failed write, 0 if none
+    private:
+        int fd;
+        int err = 0;
+    };
+    // Collects writes in one reusable buffer and hands them to a raw fd in large batches,
+    // bypassing iostreams. Safe to share between threads (setPrintSink).
+    class BufferedFdSink : public Sink {
+    public:
+        using Sink::write;
+        struct FlushPolicy {
+            bool newlineIfTerminal = true;              // flush writes containing '\n' when fd is a terminal
+            size_t sizeThreshold = 0;                   // flush once this many bytes are buffered, 0: when full
+            std::chrono::milliseconds timeThreshold{0}; // flush once the oldest buffered byte is this old, 0: off
+        };
+        // Only full buffers, flush() and the destructor write
+        static FlushPolicy explicitFlush() {
+            FlushPolicy p;
+            p.newlineIfTerminal = false;
+            return p;
         }
 
-        std::string work = fmt;
-        FormatState fs;
-        size_t argIndex = 0;
-        std::string output;
-        auto processInnerInToken = [&](const std::string &tokenSrc) {
-            std::string innerWork = tokenSrc;
-            for (size_t k = 0; k < innerWork.size();) {
-                char ch = innerWork[k];
-                if (ch == '{' && k + 1 < innerWork.size() && innerWork[k + 1] == '{') {
-                    innerWork = innerWork.substr(0, k) + "{" + innerWork.substr(k + 2);
-                    ++k;
-                    continue;
-                }
-                if (ch == '(' && k + 1 < innerWork.size() && innerWork[k + 1] == '(') {
-                    innerWork = innerWork.substr(0, k) + "(" + innerWork.substr(k + 2);
-                    ++k;
-                    continue;
-                }
-                if (ch == '{') {
-                    size_t kk = innerWork.find('}', k);
-                    if (kk == std::string::npos) {
-                        throw std::invalid_argument(std::string("Unclosed '{' inside [[]] token: [[") + tokenSrc + "]]" );
-                    }
-                    std::string inner = innerWork.substr(k + 1, kk - k - 1);
-                    if (inner.empty()) {
-                        if (argIndex >= argsVec.size()) {
-                            throw std::invalid_argument(std::string("Not enough arguments for {} inside [[]] token: [[") + tokenSrc + "]]" );
-                        }
-                        std::string rep = variantToString(argsVec[argIndex]);
-                        ++argIndex;
-                        innerWork = innerWork.substr(0, k) + rep + innerWork.substr(kk + 1);
-                        continue;
-                    } else {
-                        if (inner.find('[') != std::string::npos || inner.find('(') != std::string::npos) {
-                            k = kk + 1;
-                            continue;
-                        }
-                        auto itFA = formatAdapter.find(inner);
-                        if (itFA != formatAdapter.end()) {
-                            innerWork = innerWork.substr(0, k) + itFA->second + innerWork.substr(kk + 1);
-                            continue;
-                        } else {
-                            throw std::invalid_argument(std::string("Unknown format adapter '{") + inner + "}' inside [[]] token: [[" + tokenSrc + "]]" );
-                        }
-                    }
-                }
-                if (ch == '(') {
-                    size_t kk = innerWork.find(')', k);
-                    if (kk == std::string::npos) {
-                        throw std::invalid_argument(std::string("Unclosed '(' inside [[]] token: [[") + tokenSrc + "]]" );
-                    }
-                    std::string name = innerWork.substr(k + 1, kk - k - 1);
-                    auto it = labelAdapter.find(name);
-                    if (it != labelAdapter.end()) {
-                        innerWork = innerWork.substr(0, k) + it->second + innerWork.substr(kk + 1);
-                        continue;
-                    } else {
-                        throw std::invalid_argument(std::string("Unknown label '(") + name + ")' inside [[]] token: [[" + tokenSrc + "]]" );
-                    }
+        explicit BufferedFdSink(int fd, size_t capacity = 64 * 1024) : BufferedFdSink(fd, FlushPolicy(), capacity) {}
+        BufferedFdSink(int fd, FlushPolicy policy, size_t capacity = 64 * 1024)
+            : fd(fd), policy(policy), capacity(capacity ? capacity : 1) {
+#ifdef _WIN32
+            lineMode = policy.newlineIfTerminal && ::_isatty(fd);
+#else
+            lineMode = policy.newlineIfTerminal && ::isatty(fd);
+#endif
+            buffer.reserve(this->capacity);
+            // a quiet period must not hold the last lines back, so a thread watches their age
+            if (policy.timeThreshold.count() > 0) flusher = std::thread([this] { flushWhenDue(); });
+        }
+        ~BufferedFdSink() override {
+            if (flusher.joinable()) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stopping = true;
                 }
-                ++k;
+                wake.notify_one();
+                flusher.join();
             }
-            return innerWork;
-        };
+            flush();
+        }
+        BufferedFdSink(const BufferedFdSink&) = delete;
+        BufferedFdSink& operator=(const BufferedFdSink&) = delete;
 
-        for (size_t i = 0; i < work.size(); ) {
-            char c = work[i];
-            if (c == '{' && i + 1 < work.size() && work[i + 1] == '{') {
-                output += '{';
-                i += 2;
-                continue;
+        void write(const char *data, size_t size) override {
+            std::lock_guard<std::mutex> lock(mutex);
+            bool wasEmpty = buffer.empty();
+            if (wasEmpty && flusher.joinable()) oldest = std::chrono::steady_clock::now();
+            if (buffer.size() + size > capacity) {
+                // buffered bytes and the new data go out in one writev, nothing is copied
+                writeOut(buffer.data(), buffer.size(), data, size);
+                buffer.clear();
+                return;
             }
-            if (c == '(' && i + 1 < work.size() && work[i + 1] == '(') {
-                output += '(';
-                i += 2;
-                continue;
+            buffer.append(data, size);
+            if (wasEmpty && flusher.joinable()) wake.notify_one();
+            if ((lineMode && std::memchr(data, '\n', size))
+                || (policy.sizeThreshold && buffer.size() >= policy.sizeThreshold)
+                || (policy.timeThreshold.count() > 0 && std::chrono::steady_clock::now() - oldest >= policy.timeThreshold)) {
+                flushLocked();
             }
-            if (c == '[') {
-                if (i + 1 < work.size() && work[i + 1] == '[') {
-                    size_t j = work.find("]]", i + 2);
-                    if (j == std::string::npos) {
-                        bool looksLikeCSI = false;
-                        size_t lookEnd = std::min(work.size(), i + (size_t)20);
-                        for (size_t kk = i + 1; kk < lookEnd; ++kk) {
-                            unsigned char ch2 = static_cast<unsigned char>(work[kk]);
-                            if ((ch2 >= 'A' && ch2 <= 'Z') || (ch2 >= 'a' && ch2 <= 'z')) { looksLikeCSI = true; break; }
-                        }
-                        if (looksLikeCSI) {
-                            output += '[';
-                            ++i;
-                            continue;
-                        }
+        }
+        void flush() override {
+            std::lock_guard<std::mutex> lock(mutex);
+            flushLocked();
+        }
+        // write / writev calls issued so far
+        size_t syscalls() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            return calls;
+        }
+    private:
+        int fd;
+        FlushPolicy policy;
+        size_t capacity;
+        bool lineMode = false;
+        std::string buffer;
+        std::chrono::steady_clock::time_point oldest;
+        size_t calls = 0;
+        mutable std::mutex mutex;
+        std::condition_variable wake; // data buffered into an empty buffer, or stopping
+        bool stopping = false;
+        std::thread flusher;          // only with a timeThreshold
 
-                        std::string tail = work.substr(i, std::min<size_t>(80, work.size() - i));
-                        std::ostringstream _oss;
-                        _oss << "Unclosed '[[' in format string at pos " << i << ": '";
-                        for (unsigned char ch : tail) {
-                            if (ch >= 32 && ch <= 126) _oss << ch;
-                            else { _oss << "\\x" << std::hex << std::uppercase << (int)ch << std::dec; }
-                        }
-                        _oss << "'";
-                        throw std::invalid_argument(_oss.str());
-                    }
-                    std::string token = work.substr(i + 2, j - (i + 2));
-                    if (token.empty()) {
-                        throw std::invalid_argument("Empty [[]] directive is not allowed");
-                    }
-                    token = processInnerInToken(token);
-                    if (token == "LEFT") { fs.left = true; fs.right = false; }
-                    else if (token == "RIGHT") { fs.right = true; fs.left = false; }
-                    else if (token == "RESET") { fs.reset(); }
-                    else if (token == "FIXED") { fs.fixedFmt = true; fs.scientificFmt = false; }
-                    else if (token == "SCIENTIFIC") { fs.scientificFmt = true; fs.fixedFmt = false; }
-                    else if (token == "ENDL") { output += '\n'; }
-                    else {
-                        auto pos = token.find(':');
-                        if (pos != std::string::npos) {
-                            std::string key = token.substr(0, pos);
-                            std::string val = token.substr(pos + 1);
-                            if (key == "SETW") {
-                                if (val.empty()) throw std::invalid_argument("SETW requires a numeric value inside [[]]");
-                                try { fs.width = std::stoi(val); fs.widthTemp = true; } catch(...) { throw std::invalid_argument("Invalid integer for SETW inside [[]]: '" + val + "'"); }
-                            } else if (key == "FILL") {
-                                if (val.empty()) throw std::invalid_argument("FILL requires a character inside [[]]");
-                                fs.fillChar = val[0];
-                            } else if (key == "PREC") {
-                                if (val.empty()) throw std::invalid_argument("PREC requires a numeric value inside [[]]");
-                                try { fs.precision = std::stoi(val); } catch(...) { throw std::invalid_argument("Invalid integer for PREC inside [[]]: '" + val + "'"); }
-                            } else {
-                                throw std::invalid_argument(std::string("Unknown [[]] directive: [[") + token + "]]" );
-                            }
-                        } else {
-                            throw std::invalid_argument(std::string("Unknown [[]] directive: [[") + token + "]]" );
-                        }
-                    }
-                    i = j + 2;
-                    continue;
+        void flushWhenDue() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!stopping) {
+                if (buffer.empty()) {
+                    wake.wait(lock);
+                } else if (std::chrono::steady_clock::now() - oldest >= policy.timeThreshold) {
+                    flushLocked();
                 } else {
-                    output += '[';
-                    ++i;
-                    continue;
+                    wake.wait_until(lock, oldest + policy.timeThreshold);
                 }
             }
-
-            if (c == '(') {
-                size_t j = work.find(')', i);
-                if (j == std::string::npos) {
-                    output += '(';
-                    ++i;
-                    continue;
-                }
-                std::string name = work.substr(i + 1, j - i - 1);
-                auto it = labelAdapter.find(name);
-                if (it != labelAdapter.end()) {
-                    work = work.substr(0, i) + it->second + work.substr(j + 1);
-                    continue;
-                } else {
-                    output += work.substr(i, j - i + 1);
-                    i = j + 1;
-                    continue;
+        }
+        void flushLocked() {
+            if (buffer.empty()) return;
+            writeOut(buffer.data(), buffer.size(), nullptr, 0);
+            buffer.clear();
+        }
+        void writeOut(const char *a, size_t an, const char *b, size_t bn) {
+#ifdef _WIN32
+            for (const auto &part : {std::make_pair(a, an), std::make_pair(b, bn)}) {
+                const char *p = part.first;
+                size_t n = part.second;
+                while (n > 0) {
+                    ++calls;
+                    int w = ::_write(fd, p, static_cast<unsigned int>(n));
+                    if (w <= 0) return;
+                    p += w;
+                    n -= static_cast<size_t>(w);
                 }
             }
-
-            if (c == '{') {
-                size_t j = work.find('}', i);
-                if (j == std::string::npos) {
-                    output += '{';
-                    ++i;
-                    if (fs.widthTemp) { fs.width = 0; fs.widthTemp = false; }
-                    continue;
+#else
+            struct iovec iov[2] = {{const_cast<char*>(a), an}, {const_cast<char*>(b), bn}};
+            struct iovec *v = iov;
+            int count = bn ? 2 : 1;
+            if (an == 0) { ++v; --count; }
+            while (count > 0) {
+                ++calls;
+                ssize_t w = count == 1 ? ::write(fd, v->iov_base, v->iov_len) : ::writev(fd, v, count);
+                if (w < 0 && errno == EINTR) continue;
+                if (w <= 0) return;
+                size_t done = static_cast<size_t>(w);
+                while (count > 0 && done >= v->iov_len) {
+                    done -= v->iov_len;
+                    ++v;
+                    --count;
                 }
-                std::string inner = work.substr(i + 1, j - i - 1);
-                if (inner.empty()) {
-                    if (argIndex < argsVec.size()) {
-                        output += formatVariantWithModifiers(argsVec[argIndex], fs);
-                        ++argIndex;
-                    } else {
-                        output += "{}";
-                    }
-                    i = j + 1;
-                    continue;
-                } else {
-                    if (inner.find('[') != std::string::npos || inner.find('(') != std::string::npos) {
-                        output += work.substr(i, j - i + 1);
-                        i = j + 1;
-                        continue;
-                    }
-                    auto itF = funcAdapter.find(inner);
-                    if (itF != funcAdapter.end()) {
-                        if (argIndex < argsVec.size()) {
-                            output += itF->second(argsVec[argIndex]);
-                            ++argIndex;
-                            i = j + 1;
-                            continue;
-                        } else {
-                            throw std::invalid_argument(std::string("Not enough arguments for function format '{") + inner + "}'");
-                        }
-                    }
-                    auto itFA = formatAdapter.find(inner);
-                    if (itFA != formatAdapter.end()) {
-                        work = work.substr(0, i) + itFA->second + work.substr(j + 1);
-                        continue;
-                    } else {
-                        output += work.substr(i, j - i + 1);
-                        i = j + 1;
-                        continue;
-                    }
+                if (count > 0) {
+                    v->iov_base = static_cast<char*>(v->iov_base) + done;
+                    v->iov_len -= done;
                 }
             }
-
-            output += c;
-            ++i;
-            if (fs.widthTemp) { fs.width = 0; fs.widthTemp = false; }
+#endif
         }
+    };
+    // Write errors set the stream's badbit as for any other ostream write
+    class OStreamSink : public Sink {
+    public:
+        using Sink::write;
+        explicit OStreamSink(std::ostream &os) : os(os) {}
+        void write(const char *data, size_t size) override { os.write(data, static_cast<std::streamsize>(size)); }
+        void flush() override { os.flush(); }
+    private:
+        std::ostream &os;
+    };
 
-        ANSI256 = "";
-        ANSIBackground256 = "";
-        std::cout << output;
-    }
+    // Writes through any output iterator
+    template <typename OutputIt>
+    class OutputIteratorSink : public Sink {
+    public:
+        using Sink::write;
+        explicit OutputIteratorSink(OutputIt it) : it(it) {}
+        void write(const char *data, size_t size) override { it = std::copy(data, data + size, it); }
+        OutputIt position() const { return it; }
+    private:
+        OutputIt it;
+    };
 
-private:
-    AdapterMap formatAdapter;
-    AdapterMap labelAdapter;
-        FuncMap funcAdapter;
+    // First problem found in a format string, ok() if there is none
+    struct FormatIssue {
+        enum Code : unsigned char {
+            None,
+            Brackets,   // unbalanced ( { [[, also inside a [[...]] token
+            Directive,  // unknown or malformed [[...]]
+            Arguments,  // fewer arguments than a funcAdapter or a [[...{}...]] token needs
+            Adapter,    // unknown (LABEL) / {NAME} inside a [[...]] token
+            Type        // argument type not the one installTypedFuncAdapter<T> expects
+        };
+        std::string message;                 // what f() / print() throw
+        size_t offset = std::string::npos;   // byte in the format string the problem starts at
+        std::string token;                   // the offending text
+        Code code = None;
+        bool ok() const { return message.empty(); }
+    };
+    // Thrown by f() / print() for a malformed format; still a std::invalid_argument
+    class FormatError : public std::invalid_argument {
+    public:
+        explicit FormatError(const FormatIssue &issue) : std::invalid_argument(issue.message), issue(issue) {}
+        size_t offset() const { return issue.offset; }
+        const std::string &token() const { return issue.token; }
+        FormatIssue::Code code() const { return issue.code; }
+    private:
+        FormatIssue issue;
+    };
+    // Throws FormatError; without exceptions the message goes to stderr and the process aborts
+    [[noreturn]] static void raise(const FormatIssue &issue) {
+#ifdef ASUL_FORMAT_STRING_EXCEPTIONS
+        throw FormatError(issue);
+#else
+        std::fprintf(stderr, "AsulFormatString: %s\n", issue.message.c_str());
+        std::abort();
+#endif
+    }
 
+    template <typename... Args>
+    std::string f(std::string_view fmt, const Args&... args) {
+        std::string result;
+        StringSink sink(result);
+        print(sink, fmt, args...);
+        return result;
+    }
+    void print(std::string_view fmt) {
+        print(fmt,"");
+    }
+    template <typename... Args>
+    void print(std::string_view fmt, const Args&... args) {
+        // formatted up front so a malformed format prints nothing
+        std::string output;
+        StringSink sink(output);
+        print(sink, fmt, args...);
+        writePrinted(output);
+    }
+    // Where print(fmt, ...) writes, std::cout when null. Each print() call reaches the sink
+    // as a single write of the whole formatted text. The sink must outlive its use here.
+    void setPrintSink(Sink *sink) { printSink.store(sink, std::memory_order_release); }
+    Sink *getPrintSink() const { return printSink.load(std::memory_order_acquire); }
+    // Formats straight into any sink, throws FormatError for a malformed format
+    template <typename... Args>
+    void print(Sink &sink, std::string_view fmt, const Args&... args) {
+        FormatIssue issue = try_print(sink, fmt, args...);
+        if (!issue.ok()) raise(issue);
+    }
 
-    std::string ANSI256="", ANSIBackground256="";
+    // Exception-free forms. A malformed format or a missing argument comes back as the
+    // FormatIssue f() / print() would have thrown; nothing is thrown on the way. These also
+    // work when built with -fno-exceptions.
+    struct FormatResult {
+        std::string text;   // empty when the format failed
+        FormatIssue issue;
+        bool ok() const { return issue.ok(); }
+        explicit operator bool() const { return ok(); }
+        const std::string &value() const { return text; }
+        const FormatIssue &error() const { return issue; }
+    };
+    template <typename Fmt, typename... Args, typename = std::enable_if_t<!std::is_base_of_v<Sink, Fmt> > >
+    FormatResult try_f(const Fmt &fmt, const Args&... args) {
+        FormatResult r;
+        StringSink sink(r.text);
+        r.issue = try_print(sink, fmt, args...);
+        if (!r.ok()) r.text.clear();
+        return r;
+    }
+    // Prints nothing when the format fails
+    template <typename Fmt, typename... Args, typename = std::enable_if_t<!std::is_base_of_v<Sink, Fmt> > >
+    FormatIssue try_print(const Fmt &fmt, const Args&... args) {
+        std::string output;
+        StringSink sink(output);
+        FormatIssue issue = try_print(sink, fmt, args...);
+        if (issue.ok()) writePrinted(output);
+        return issue;
+    }
+    // Every other entry point ends up here. Output written before a failure stays in sink.
+    template <typename... Args>
+    FormatIssue try_print(Sink &sink, std::string_view fmt, const Args&... args) {
+        // arguments are borrowed for the duration of the call, nothing is copied
+        const FormatArg argv[] = {makeArg(args)..., FormatArg()};
 
-    void argvs_helper(std::vector<VariantType>& vec) { /* no args */ }
+        ProfileCall call(*this, fmt, sink);
+        SnapshotScope scope(*this);
+        std::shared_ptr<const CompiledFormat> cf = compiledFormat(fmt, scope);
+        FormatIssue issue;
+        call.consumed(runCompiled(*cf, scope.registry(), ArgList{argv, sizeof...(Args)}, call.sink(), issue));
+        return issue;
+    }
 
-    template <typename T>
-    struct is_streamable {
-        template <typename U>
-        static auto test(int) -> decltype(std::declval<std::ostream&>() << std::declval<U>(), std::true_type());
-        template <typename>
-        static auto test(...) -> std::false_type;
-        static constexpr bool value = decltype(test<T>(0))::value;
+    // Formatting into caller owned buffers. fmt may be a string or an AFS_FMT literal.
+    // Formats through the std::iterator range starting at out, returns the end of the output
+    template <typename OutputIt, typename Fmt, typename... Args>
+    OutputIt f_to(OutputIt out, const Fmt& fmt, const Args&... args) {
+        OutputIteratorSink<OutputIt> sink(out);
+        print(sink, fmt, args...);
+        return sink.position();
+    }
+    struct FormatToNResult {
+        size_t needed = 0;   // full length of the formatted text
+        size_t written = 0;  // bytes stored in the buffer, never more than its size
+        bool truncated() const { return needed > written; }
     };
-
-    template <typename T>
-    void argvs_helper(std::vector<VariantType>& vec, const T& first) {
-        using DT = std::decay_t<T>;
-        if constexpr (std::is_same_v<DT, int> || std::is_same_v<DT, double> || std::is_same_v<DT, std::string> || std::is_same_v<DT, bool> || std::is_same_v<DT, char> || std::is_same_v<DT, std::any>) {
-            vec.push_back(first);
-        } else if constexpr (std::is_same_v<DT, const char*> || std::is_same_v<DT, char*>) {
-            vec.push_back(std::string(first));
-        } else if constexpr (is_streamable<DT>::value) {
-            std::ostringstream oss; oss << first; vec.push_back(oss.str());
-        } else {
-            // unknown/non-streamable custom type: store as std::any so installTypedFuncAdapter can any_cast it
-            vec.push_back(std::any(first));
-        }
+    // Writes at most n bytes (no terminating NUL) and reports the full length
+    template <typename Fmt, typename... Args>
+    FormatToNResult f_to_n(char *buf, size_t n, const Fmt& fmt, const Args&... args) {
+        FixedBufferSink sink(buf, n);
+        print(sink, fmt, args...);
+        FormatToNResult r;
+        r.needed = sink.needed();
+        r.written = sink.size();
+        return r;
     }
-    template <typename T, typename... Args>
-    void argvs_helper(std::vector<VariantType>& vec, const T& first, const Args&... args) {
-        // Use the single-argument overload to correctly handle conversion/any storage
-        argvs_helper(vec, first);
-        argvs_helper(vec, args...);
+    // Appends to out, reusing its capacity
+    template <typename Fmt, typename... Args>
+    std::string& f_append(std::string &out, const Fmt& fmt, const Args&... args) {
+        StringSink sink(out);
+        print(sink, fmt, args...);
+        return out;
     }
 
-    bool hasValidCurlyBraces(const std::string& s) {
-        std::stack<char> p;
-        for (size_t i = 0; i < s.size(); ++i) {
-            char c = s[i];
-            if (c == '{') {
-                if (i + 1 < s.size() && s[i + 1] == '{') { ++i; continue; }
-                p.push('{');
-            } else if (c == '}') {
-                if (i + 1 < s.size() && s[i + 1] == '}') { ++i; continue; }
-                if (!p.empty() && p.top() == '{') {
-                    p.pop();
-                }
+    // Tables: one row template for many rows. The template is compiled once, the rows are
+    // formatted back to back into a buffer that reaches the sink in 64 KiB chunks. rows is a
+    // range of rows, each a tuple / pair / std::array or a range (e.g. a std::vector of
+    // strings) with one element per {}, or columns(a, b, ...) for equally long columns.
+    struct TableOptions {
+        // Measure the data first and pad every {} without a SETW of its own to its widest
+        // value. Templates with [[...]] tokens that take {} / adapters are printed as written.
+        bool autoWidth = false;
+        // Formatting threads, 0 for one per core. Above 1, blocks of rows are formatted in
+        // parallel and written in input order by the calling thread; funcAdapters and
+        // AsulFormatter specializations then run on the worker threads.
+        unsigned threads = 1;
+    };
+    // Walks columns side by side, row i being the i-th element of each. Columns are borrowed.
+    template <typename... Columns>
+    class ColumnView {
+    public:
+        explicit ColumnView(const Columns&... cols) : cols(cols...) {}
+        size_t rows() const {
+            return std::apply([](const auto&... c) { return std::min({length(c)...}); }, cols);
+        }
+        bool sameLength() const {
+            return std::apply([](const auto&... c) { return std::max({length(c)...}) == std::min({length(c)...}); }, cols);
+        }
+        // One iterator per column, on row first
+        auto cursor(size_t first = 0) const {
+            return std::apply([&](const auto&... c) {
+                return std::make_tuple(std::next(std::begin(c), static_cast<std::ptrdiff_t>(first))...);
+            }, cols);
+        }
+        // fn gets a tuple of references to the row's elements and returns false to stop;
+        // at most count rows from row first
+        template <typename Fn>
+        void each(Fn &&fn, size_t first = 0, size_t count = std::string::npos) const {
+            size_t n = rows();
+            first = std::min(first, n);
+            auto its = cursor(first);
+            eachFrom(fn, its, std::min(n - first, count));
+        }
+        // count rows from its, which is left on the row after the last one visited; count
+        // must not run past the shortest column
+        template <typename Fn, typename Cursor>
+        static bool eachFrom(Fn &&fn, Cursor &its, size_t count) {
+            for (; count > 0; --count) {
+                if (!std::apply([&](auto&... it) { return fn(std::forward_as_tuple(*it...)); }, its)) return false;
+                std::apply([](auto&... it) { (++it, ...); }, its);
             }
+            return true;
         }
-        return p.empty();
+    private:
+        template <typename C>
+        static size_t length(const C &c) { return static_cast<size_t>(std::distance(std::begin(c), std::end(c))); }
+        std::tuple<const Columns&...> cols;
+    };
+    template <typename... Columns>
+    static ColumnView<Columns...> columns(const Columns&... cols) { return ColumnView<Columns...>(cols...); }
+
+    // The whole table as one string
+    template <typename Rows>
+    std::string f_rows(std::string_view rowFmt, const Rows &rows, TableOptions options = TableOptions()) {
+        std::string result;
+        StringSink sink(result);
+        print_rows(sink, rowFmt, rows, options);
+        return result;
     }
+    // Rows to the print target (see setPrintSink), written as they are formatted
+    template <typename Rows>
+    void print_rows(std::string_view rowFmt, const Rows &rows, TableOptions options = TableOptions()) {
+        PrintTargetSink sink(*this);
+        print_rows(sink, rowFmt, rows, options);
+    }
+    template <typename Rows>
+    void print_rows(Sink &sink, std::string_view rowFmt, const Rows &rows, TableOptions options = TableOptions()) {
+        FormatIssue issue = try_print_rows(sink, rowFmt, rows, options);
+        if (!issue.ok()) raise(issue);
+    }
+    template <typename Rows>
+    FormatIssue try_print_rows(std::string_view rowFmt, const Rows &rows, TableOptions options = TableOptions()) {
+        PrintTargetSink sink(*this);
+        return try_print_rows(sink, rowFmt, rows, options);
+    }
+    // A malformed template or uneven columns print nothing; a row failing on its arguments
+    // stops the table there: the rows before it are written, nothing of the failing row
+    // (as print() writes nothing of a failing line). Profiled as one call.
+    template <typename Rows>
+    FormatIssue try_print_rows(Sink &sink, std::string_view rowFmt, const Rows &rows, TableOptions options = TableOptions()) {
+        if constexpr (isColumnView<Rows>::value) {
+            if (!rows.sameLength()) return FormatIssue{"Columns of a table differ in length", std::string::npos, "", FormatIssue::Arguments};
+        }
+        ProfileCall call(*this, rowFmt, sink);
+        SnapshotScope scope(*this);
+        std::shared_ptr<const CompiledFormat> cf = compiledFormat(rowFmt, scope);
+        if (!cf->issue.ok()) return cf->issue;
+        unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+        size_t rowCount = threads > 1 ? tableRows(rows) : 0;
+        if (rowCount < 2 * minBlockRows) threads = 1;
+        const size_t blockRows = threads > 1 ? blockRowsFor(rowCount, threads) : 0;
+        const auto starts = blockCursors(rows, threads > 1 ? rowCount : 0, blockRows);
+        CompiledFormat sized;
+        const CompiledFormat *use = cf.get();
+        if (options.autoWidth && widenColumns(*cf, rows, sized, threads, rowCount, starts)) use = &sized;
 
-    bool hasValidParentheses(const std::string& s) {
-        std::stack<char> p;
-        for (size_t i = 0; i < s.size(); ++i) {
-            char c = s[i];
-            if (c == '(') {
-                if (i + 1 < s.size() && s[i + 1] == '(') { ++i; continue; }
-                p.push('(');
-            } else if (c == ')') {
-                if (i + 1 < s.size() && s[i + 1] == ')') { ++i; continue; }
-                if (!p.empty() && p.top() == '(') {
-                    p.pop();
+        FormatIssue issue;
+        size_t consumed = 0;
+        if (threads > 1) {
+            issue = runRowsParallel(*use, scope.registry(), rows, starts, rowCount, threads, call.sink(), consumed);
+        } else {
+            ChunkSink buffer(call.sink());
+            auto cur = rowCursor(rows);
+            forEachRow(rows, cur, std::string::npos, [&](ArgList args) {
+                consumed += runCompiled(*use, scope.registry(), args, buffer, issue);
+                if (!issue.ok()) {
+                    buffer.dropRow();
+                    return false;
                 }
-            }
+                buffer.endRow();
+                return true;
+            });
+            buffer.flush();
         }
-        return p.empty();
+        call.consumed(consumed);
+        return issue;
     }
 
-    bool hasValidSquareBrackets(const std::string& s) {
-        std::stack<char> p;
-        for (size_t i = 0; i < s.size(); ++i) {
-            unsigned char c = static_cast<unsigned char>(s[i]);
-            if (c == '[') {
-                if (i > 0 && static_cast<unsigned char>(s[i - 1]) == 27) continue;
-                if (i + 1 < s.size() && s[i + 1] == '[') {
-                    p.push('[');
-                    ++i;
-                } else {
-                    continue;
-                }
-            } else if (c == ']') {
-                if (i + 1 < s.size() && s[i + 1] == ']') {
-                    if (p.empty() || p.top() != '[') return false;
-                    p.pop();
-                    ++i;
-                } else {
-                    continue;
+    // Compiled format cache
+    struct FormatCacheStats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+        size_t invalidations = 0;
+        size_t size = 0;
+        size_t capacity = 0;
+    };
+    // Each thread caches compiled formats on its own; hits / misses / evictions / size are
+    // those of the calling thread, invalidations count registry changes of this instance
+    FormatCacheStats formatCacheStats() const {
+        SnapshotScope scope(*this);
+        const FormatCache &cache = scope.cache();
+        FormatCacheStats st;
+        st.hits = cache.hits;
+        st.misses = cache.misses;
+        st.evictions = cache.evictions;
+        st.invalidations = cacheInvalidations.load(std::memory_order_relaxed);
+        st.size = cache.size();
+        st.capacity = cache.capacity;
+        return st;
+    }
+
+    // Per format string profile. Only collected when ALLOW_PROFILE_ASULFORMATSTRING is
+    // defined; otherwise stats() is always empty and print() carries no profiling code.
+    struct FormatStats {
+        std::string format;          // the format string, AFS_FMT text for static formats
+        uint64_t calls = 0;
+        uint64_t totalNs = 0;
+        uint64_t maxNs = 0;
+        uint64_t outputBytes = 0;
+        uint64_t argsConsumed = 0;
+        uint64_t adapterLookups = 0; // (LABEL) / {NAME} registry lookups, compiling included
+        uint64_t allocations = 0;    // only counted with setProfileAllocationCounter()
+    };
+    struct StatsSnapshot {
+        std::vector<FormatStats> formats; // most total time first
+        std::string text() const {
+            std::string out = "calls        total ns       max ns    avg ns     bytes   args lookups   allocs  format\n";
+            char line[128];
+            for (const FormatStats &s : formats) {
+                std::snprintf(line, sizeof line, "%-10llu %10llu %12llu %9llu %9llu %6llu %7llu %8llu  ",
+                              ull(s.calls), ull(s.totalNs), ull(s.maxNs), ull(s.calls ? s.totalNs / s.calls : 0),
+                              ull(s.outputBytes), ull(s.argsConsumed), ull(s.adapterLookups), ull(s.allocations));
+                out += line;
+                appendEscaped(out, s.format, false);
+                out += '\n';
+            }
+            return out;
+        }
+        // One JSON array, an object per format string
+        std::string json() const {
+            std::string out = "[";
+            for (const FormatStats &s : formats) {
+                if (out.size() > 1) out += ',';
+                out += "\n  {\"format\":\"";
+                appendEscaped(out, s.format, true);
+                out += "\",\"calls\":" + std::to_string(s.calls);
+                out += ",\"total_ns\":" + std::to_string(s.totalNs);
+                out += ",\"max_ns\":" + std::to_string(s.maxNs);
+                out += ",\"output_bytes\":" + std::to_string(s.outputBytes);
+                out += ",\"args_consumed\":" + std::to_string(s.argsConsumed);
+                out += ",\"adapter_lookups\":" + std::to_string(s.adapterLookups);
+                out += ",\"allocations\":" + std::to_string(s.allocations) + "}";
+            }
+            out += formats.empty() ? "]" : "\n]";
+            return out;
+        }
+    private:
+        static unsigned long long ull(uint64_t v) { return static_cast<unsigned long long>(v); }
+        // Control bytes (colors are ESC sequences) as \n / \u001b, so a dump stays one line per format
+        static void appendEscaped(std::string &out, std::string_view s, bool json) {
+            for (char c : s) {
+                unsigned char u = static_cast<unsigned char>(c);
+                if (c == '\n') out += "\\n";
+                else if (c == '\t') out += "\\t";
+                else if (json && (c == '"' || c == '\\')) { out += '\\'; out += c; }
+                else if (u < 0x20 || u == 0x7F) {
+                    char esc[8];
+                    std::snprintf(esc, sizeof esc, "\\u%04x", u);
+                    out += esc;
                 }
+                else out += c;
             }
         }
-        return p.empty();
+    };
+    // Totals of every thread that formatted with this instance, threads that exited included
+    StatsSnapshot stats() const {
+        StatsSnapshot snap;
+#ifdef ALLOW_PROFILE_ASULFORMATSTRING
+        std::unordered_map<std::string_view, FormatStats> merged;
+        std::lock_guard<std::mutex> lock(profiles->mutex);
+        auto add = [&](const ThreadProfile &tp) {
+            for (const auto &e : tp.formats) mergeStats(merged[e.first], *e.second);
+        };
+        add(profiles->exited);
+        for (const auto &p : profiles->live) {
+            std::lock_guard<std::mutex> tableLock(p->mutex);
+            add(*p);
+        }
+        snap.formats.reserve(merged.size());
+        for (auto &m : merged) {
+            m.second.format = std::string(m.first);
+            snap.formats.push_back(std::move(m.second));
+        }
+        std::sort(snap.formats.begin(), snap.formats.end(), [](const FormatStats &a, const FormatStats &b) {
+            return a.totalNs != b.totalNs ? a.totalNs > b.totalNs : a.format < b.format;
+        });
+#endif
+        return snap;
     }
-
-    std::string processAdapter(const std::string& fmt) {
-        std::string processed = fmt;
-        std::regex pattern(R"(\{(\w+)\})");
-        std::smatch match;
-        std::string temp = processed;
-        
-        processed.clear();
-        while (std::regex_search(temp, match, pattern)) {
-            processed += temp.substr(0, match.position());
-            std::string placeholder = match[1];
-            if (formatAdapter.find(placeholder) != formatAdapter.end()) {
-                processed += formatAdapter[placeholder];
-            } else {
-                processed += match[0];
-            }
-            
-            temp = match.suffix();
-        }
-        processed += temp;
-        
-        return processed;
-    }
-
-    std::string processLabelAdapter(const std::string& fmt) {
-        std::string processed = fmt;
-        std::regex pattern(R"(\((\w+)\))");
-        std::smatch match;
-        std::string temp = processed;
-        
-        processed.clear();
-        while (std::regex_search(temp, match, pattern)) {
-            processed += temp.substr(0, match.position());
-            std::string placeholder = match[1];
-            if (labelAdapter.find(placeholder) != labelAdapter.end()) {
-                processed += labelAdapter[placeholder];
-            } else {
-                processed += match[0];
-            }
-            temp = match.suffix();
+    void resetStats() {
+#ifdef ALLOW_PROFILE_ASULFORMATSTRING
+        std::lock_guard<std::mutex> lock(profiles->mutex);
+        profiles->exited.formats.clear();
+        for (const auto &p : profiles->live) {
+            std::lock_guard<std::mutex> tableLock(p->mutex);
+            p->formats.clear();
         }
-        processed += temp;
-        return processed;
+#endif
+    }
+    // The header cannot see allocations by itself. Give it a function returning the calling
+    // thread's running allocation count (e.g. bumped by a replaced operator new) and every
+    // profiled call records the difference across it. nullptr turns it off again.
+    static void setProfileAllocationCounter(uint64_t (*counter)()) {
+        allocationCounter().store(counter, std::memory_order_release);
+    }
+    // Checks a format against the current adapters without formatting anything, e.g. to
+    // pre-check a message catalog. [[...]] tokens that need arguments are not resolved.
+    FormatIssue validate(std::string_view fmt) {
+        SnapshotScope scope(*this);
+        std::shared_ptr<const CompiledFormat> cf = compiledFormat(fmt, scope);
+        return cf->issue;
     }
 
-    
-    struct FormatState {
-        bool left = false;
-        bool right = false;
+    // Compiles the label, format and func adapters of the current registry into one read-only
+    // perfect hash keyed by string_view, so (NAME) / {NAME} lookups take a single probe and
+    // never allocate. Any later install* / clear* drops it again. Returns false (and stays
+    // unfrozen) in the unlikely case no hash seeds are found.
+    bool freeze() {
+        bool ok = false;
+        updateRegistry([&](Registry &reg) {
+            reg.frozen = FrozenAdapters::build(reg);
+            ok = reg.frozen != nullptr;
+        });
+        return ok;
+    }
+    bool frozen() const { return loadRegistry()->frozen != nullptr; }
+    // Per thread bound, 0 disables caching
+    void setFormatCacheCapacity(size_t capacity) { cacheCapacity.store(capacity, std::memory_order_relaxed); }
+    // Drops the compiled formats of every thread
+    void clearFormatCache() {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        publish(loadRegistry());
+    }
+
+    // Finds the next byte that can start or close format syntax: { } ( ) [ ] or ESC.
+    // compileFormat and the bracket checks use it to take literal runs whole instead of
+    // byte by byte. On x86 the widest kernel the CPU supports is picked once at runtime.
+    struct MetaScanner {
+        using ScanFn = size_t (*)(const char *, size_t);
+
+        // Offset of the first meta byte in [s, s + n), n if there is none
+        static size_t find(const char *s, size_t n) { return kernel()(s, n); }
+        static size_t find(std::string_view s, size_t from) {
+            return from >= s.size() ? s.size() : from + find(s.data() + from, s.size() - from);
+        }
+        static const char *path() {
+            ScanFn fn = kernel();
+#ifdef ASUL_FORMAT_STRING_AVX2
+            if (fn == avx2) return "avx2";
+#endif
+#ifdef ASUL_FORMAT_STRING_SSE2
+            if (fn == sse2) return "sse2";
+#endif
+            return fn == scalar ? "scalar" : "unknown";
+        }
+
+        static bool isMeta(unsigned char c) {
+            return c == '{' || c == '}' || c == '(' || c == ')' || c == '[' || c == ']' || c == 27;
+        }
+        static size_t scalar(const char *s, size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                if (isMeta(static_cast<unsigned char>(s[i]))) return i;
+            }
+            return n;
+        }
+#ifdef ASUL_FORMAT_STRING_SSE2
+        static size_t sse2(const char *s, size_t n) {
+            const __m128i curlyOpen = _mm_set1_epi8('{'), curlyClose = _mm_set1_epi8('}');
+            const __m128i paren = _mm_set1_epi8(')'), one = _mm_set1_epi8(1); // ( and ) differ in bit 0
+            const __m128i squareOpen = _mm_set1_epi8('['), squareClose = _mm_set1_epi8(']'), esc = _mm_set1_epi8(27);
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+                __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, curlyOpen), _mm_cmpeq_epi8(v, curlyClose));
+                m = _mm_or_si128(m, _mm_cmpeq_epi8(_mm_or_si128(v, one), paren));
+                m = _mm_or_si128(m, _mm_or_si128(_mm_cmpeq_epi8(v, squareOpen), _mm_cmpeq_epi8(v, squareClose)));
+                m = _mm_or_si128(m, _mm_cmpeq_epi8(v, esc));
+                unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(m));
+                if (mask) return i + lowestBit(mask);
+            }
+            return i + scalar(s + i, n - i);
+        }
+#endif
+#ifdef ASUL_FORMAT_STRING_AVX2
+        __attribute__((target("avx2"))) static size_t avx2(const char *s, size_t n) {
+            const __m256i curlyOpen = _mm256_set1_epi8('{'), curlyClose = _mm256_set1_epi8('}');
+            const __m256i paren = _mm256_set1_epi8(')'), one = _mm256_set1_epi8(1);
+            const __m256i squareOpen = _mm256_set1_epi8('['), squareClose = _mm256_set1_epi8(']'), esc = _mm256_set1_epi8(27);
+            size_t i = 0;
+            for (; i + 32 <= n; i += 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+                __m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(v, curlyOpen), _mm256_cmpeq_epi8(v, curlyClose));
+                m = _mm256_or_si256(m, _mm256_cmpeq_epi8(_mm256_or_si256(v, one), paren));
+                m = _mm256_or_si256(m, _mm256_or_si256(_mm256_cmpeq_epi8(v, squareOpen), _mm256_cmpeq_epi8(v, squareClose)));
+                m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, esc));
+                unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(m));
+                if (mask) return i + lowestBit(mask);
+            }
+            return i + sse2(s + i, n - i);
+        }
+#endif
+        static size_t lowestBit(unsigned mask) {
+#if defined(__GNUC__)
+            return static_cast<size_t>(__builtin_ctz(mask));
+#else
+            size_t bit = 0;
+            while (!(mask & 1u)) { mask >>= 1; ++bit; }
+            return bit;
+#endif
+        }
+    private:
+        static ScanFn kernel() {
+            static const ScanFn fn = [] {
+#ifdef ASUL_FORMAT_STRING_AVX2
+                if (__builtin_cpu_supports("avx2")) return static_cast<ScanFn>(avx2);
+#endif
+#ifdef ASUL_FORMAT_STRING_SSE2
+                return static_cast<ScanFn>(sse2);
+#else
+                return static_cast<ScanFn>(scalar);
+#endif
+            }();
+            return fn;
+        }
+    };
+
+    // Terminal columns of UTF-8 text, what SETW / LEFT / RIGHT pad to: ANSI escape sequences
+    // take none, East Asian wide and fullwidth characters two, combining marks and other
+    // zero width characters none, anything else one (so do bytes that are not valid UTF-8).
+    // Plain ASCII is counted 16 bytes at a time with SSE2 and stays one column per byte.
+    struct DisplayWidth {
+        static size_t of(std::string_view s) {
+            size_t width = 0;
+            for (size_t i = 0; i < s.size(); ) {
+                size_t run = asciiRun(s.data() + i, s.size() - i);
+                width += run;
+                i += run;
+                if (i == s.size()) break;
+                if (s[i] == '\033') {
+                    i = skipEscape(s, i);
+                    continue;
+                }
+                uint32_t cp = 0;
+                size_t len = decodeUtf8(s, i, cp);
+                if (len == 0) {
+                    ++width;
+                    ++i;
+                } else {
+                    width += of(cp);
+                    i += len;
+                }
+            }
+            return width;
+        }
+        // Columns of one code point
+        static size_t of(uint32_t cp) {
+            if (cp < 0x300) return cp >= 0x7F && cp < 0xA0 ? 0 : 1;
+            // CJK ideographs and Hangul syllables, most of the wide text there is
+            if ((cp >= 0x4E00 && cp <= 0x9FFF) || (cp >= 0xAC00 && cp <= 0xD7A3)) return 2;
+            if (inRanges(cp, zeroWidth, sizeof zeroWidth / sizeof zeroWidth[0])) return 0;
+            return inRanges(cp, wide, sizeof wide / sizeof wide[0]) ? 2 : 1;
+        }
+        // Length of the leading run of ASCII bytes other than ESC
+        static size_t asciiRun(const char *s, size_t n) {
+            size_t i = 0;
+#ifdef ASUL_FORMAT_STRING_SSE2
+            const __m128i esc = _mm_set1_epi8(27);
+            for (; i + 16 <= n; i += 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+                // the sign bit marks bytes >= 0x80, the compare ESC
+                unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(v, _mm_cmpeq_epi8(v, esc))));
+                if (mask) return i + MetaScanner::lowestBit(mask);
+            }
+#endif
+            for (; i < n; ++i) {
+                unsigned char c = static_cast<unsigned char>(s[i]);
+                if (c >= 0x80 || c == 27) break;
+            }
+            return i;
+        }
+    private:
+        struct Range { uint32_t first, last; };
+        static bool inRanges(uint32_t cp, const Range *r, size_t n) {
+            size_t lo = 0, hi = n;
+            while (lo < hi) {
+                size_t mid = (lo + hi) / 2;
+                if (cp > r[mid].last) lo = mid + 1;
+                else if (cp < r[mid].first) hi = mid;
+                else return true;
+            }
+            return false;
+        }
+        // CSI (ESC [ ... final byte), OSC (ESC ] ... BEL or ESC \) or a two byte escape
+        static size_t skipEscape(std::string_view s, size_t i) {
+            if (i + 1 >= s.size()) return s.size();
+            if (s[i + 1] == '[') {
+                size_t j = i + 2;
+                while (j < s.size() && s[j] >= 0x20 && s[j] <= 0x3F) ++j;
+                return std::min(j + 1, s.size());
+            }
+            if (s[i + 1] == ']') {
+                for (size_t j = i + 2; j < s.size(); ++j) {
+                    if (s[j] == '\a') return j + 1;
+                    if (s[j] == '\033' && j + 1 < s.size() && s[j + 1] == '\\') return j + 2;
+                }
+                return s.size();
+            }
+            return i + 2;
+        }
+        // Bytes of the well formed UTF-8 sequence at s[i], 0 if there is none
+        static size_t decodeUtf8(std::string_view s, size_t i, uint32_t &cp) {
+            unsigned char c = static_cast<unsigned char>(s[i]);
+            size_t len = c >= 0xF0 && c <= 0xF4 ? 4 : c >= 0xE0 && c <= 0xEF ? 3 : c >= 0xC2 && c <= 0xDF ? 2 : 0;
+            if (len == 0 || i + len > s.size()) return 0;
+            cp = c & (0x7F >> len);
+            for (size_t k = 1; k < len; ++k) {
+                unsigned char cc = static_cast<unsigned char>(s[i + k]);
+                if ((cc & 0xC0) != 0x80) return 0;
+                cp = (cp << 6) | (cc & 0x3F);
+            }
+            bool overlong = (len == 3 && cp < 0x800) || (len == 4 && cp < 0x10000);
+            if (overlong || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) return 0;
+            return len;
+        }
+        // Combining marks, zero width spaces / joiners, variation selectors
+        static constexpr Range zeroWidth[] = {
+            {0x0300, 0x036F}, {0x0483, 0x0489}, {0x0591, 0x05BD}, {0x05BF, 0x05BF}, {0x05C1, 0x05C2}, {0x05C4, 0x05C5},
+            {0x05C7, 0x05C7}, {0x0610, 0x061A}, {0x064B, 0x065F}, {0x0670, 0x0670}, {0x06D6, 0x06DC}, {0x06DF, 0x06E4},
+            {0x06E7, 0x06E8}, {0x06EA, 0x06ED}, {0x0E31, 0x0E31}, {0x0E34, 0x0E3A}, {0x0E47, 0x0E4E}, {0x1160, 0x11FF},
+            {0x1AB0, 0x1AFF}, {0x1DC0, 0x1DFF}, {0x200B, 0x200F}, {0x2028, 0x202E}, {0x2060, 0x2064}, {0x20D0, 0x20FF},
+            {0x302A, 0x302D}, {0x3099, 0x309A}, {0xFE00, 0xFE0F}, {0xFE20, 0xFE2F}, {0xFEFF, 0xFEFF}, {0xE0100, 0xE01EF},
+        };
+        // East Asian Wide / Fullwidth: Hangul Jamo, CJK, Hiragana / Katakana, Hangul syllables,
+        // fullwidth forms, emoji
+        static constexpr Range wide[] = {
+            {0x1100, 0x115F}, {0x231A, 0x231B}, {0x2329, 0x232A}, {0x23E9, 0x23EC}, {0x23F0, 0x23F0}, {0x23F3, 0x23F3},
+            {0x25FD, 0x25FE}, {0x2614, 0x2615}, {0x2648, 0x2653}, {0x267F, 0x267F}, {0x2693, 0x2693}, {0x26A1, 0x26A1},
+            {0x26AA, 0x26AB}, {0x26BD, 0x26BE}, {0x26C4, 0x26C5}, {0x26CE, 0x26CE}, {0x26D4, 0x26D4}, {0x26EA, 0x26EA},
+            {0x26F2, 0x26F3}, {0x26F5, 0x26F5}, {0x26FA, 0x26FA}, {0x26FD, 0x26FD}, {0x2705, 0x2705}, {0x270A, 0x270B},
+            {0x2728, 0x2728}, {0x274C, 0x274C}, {0x274E, 0x274E}, {0x2753, 0x2755}, {0x2757, 0x2757}, {0x2795, 0x2797},
+            {0x27B0, 0x27B0}, {0x27BF, 0x27BF}, {0x2B1B, 0x2B1C}, {0x2B50, 0x2B50}, {0x2B55, 0x2B55}, {0x2E80, 0x3029},
+            {0x302E, 0x303E}, {0x3041, 0x3098}, {0x309B, 0x33FF}, {0x3400, 0x4DBF}, {0x4E00, 0x9FFF}, {0xA000, 0xA4CF},
+            {0xA960, 0xA97F}, {0xAC00, 0xD7A3}, {0xF900, 0xFAFF}, {0xFE10, 0xFE19}, {0xFE30, 0xFE6F}, {0xFF00, 0xFF60},
+            {0xFFE0, 0xFFE6}, {0x16FE0, 0x16FE4}, {0x17000, 0x18AFF}, {0x1B000, 0x1B2FF}, {0x1F004, 0x1F004}, {0x1F0CF, 0x1F0CF},
+            {0x1F18E, 0x1F18E}, {0x1F191, 0x1F19A}, {0x1F200, 0x1F251}, {0x1F300, 0x1F320}, {0x1F32D, 0x1F335}, {0x1F337, 0x1F37C},
+            {0x1F37E, 0x1F393}, {0x1F3A0, 0x1F3CA}, {0x1F3CF, 0x1F3D3}, {0x1F3E0, 0x1F3F0}, {0x1F3F4, 0x1F3F4}, {0x1F3F8, 0x1F43E},
+            {0x1F440, 0x1F440}, {0x1F442, 0x1F4FC}, {0x1F4FF, 0x1F53D}, {0x1F54B, 0x1F54E}, {0x1F550, 0x1F567}, {0x1F57A, 0x1F57A},
+            {0x1F595, 0x1F596}, {0x1F5A4, 0x1F5A4}, {0x1F5FB, 0x1F64F}, {0x1F680, 0x1F6C5}, {0x1F6CC, 0x1F6CC}, {0x1F6D0, 0x1F6D2},
+            {0x1F6D5, 0x1F6D7}, {0x1F6EB, 0x1F6EC}, {0x1F6F4, 0x1F6FC}, {0x1F7E0, 0x1F7EB}, {0x1F90C, 0x1F93A}, {0x1F93C, 0x1F945},
+            {0x1F947, 0x1F9FF}, {0x1FA70, 0x1FAFF}, {0x20000, 0x2FFFD}, {0x30000, 0x3FFFD},
+        };
+    };
+
+    // Compile-time checked format literals, see AFS_FMT
+    struct StaticFormatTag {};
+
+    template <typename Fmt, typename... Args, typename = std::enable_if_t<std::is_base_of_v<StaticFormatTag, Fmt> > >
+    std::string f(Fmt fmt, const Args&... args) {
+        std::string result;
+        StringSink sink(result);
+        print(sink, fmt, args...);
+        return result;
+    }
+    template <typename Fmt, typename... Args, typename = std::enable_if_t<std::is_base_of_v<StaticFormatTag, Fmt> > >
+    void print(Fmt fmt, const Args&... args) {
+        std::string output;
+        StringSink sink(output);
+        print(sink, fmt, args...);
+        writePrinted(output);
+    }
+    template <typename Fmt, typename... Args, typename = std::enable_if_t<std::is_base_of_v<StaticFormatTag, Fmt> > >
+    void print(Sink &sink, Fmt fmt, const Args&... args) {
+        FormatIssue issue = try_print(sink, fmt, args...);
+        if (!issue.ok()) raise(issue);
+    }
+    template <typename Fmt, typename... Args, typename = std::enable_if_t<std::is_base_of_v<StaticFormatTag, Fmt> > >
+    FormatIssue try_print(Sink &sink, Fmt, const Args&... args) {
+        checkStaticFormat<Fmt, sizeof...(Args)>();
+        const FormatArg argv[] = {makeArg(args)..., FormatArg()};
+
+        ProfileCall call(*this, Fmt::value(), sink);
+        SnapshotScope scope(*this);
+        std::shared_ptr<const CompiledFormat> cf = staticCompiledFormat<Fmt>(scope);
+        FormatIssue issue;
+        call.consumed(runCompiled(*cf, scope.registry(), ArgList{argv, sizeof...(Args)}, call.sink(), issue));
+        return issue;
+    }
+
+private:
+    // What a name resolves to; kinds says which of the three pointers are set
+    struct AdapterEntry {
+        enum Kind : unsigned char { Label = 1, Format = 2, Func = 4 };
+        std::string_view name;
+        unsigned char kinds = 0;
+        const std::string *label = nullptr;
+        const std::string *format = nullptr;
+        const FuncMap::mapped_type *func = nullptr;
+        const FuncTypeCheck *accepts = nullptr; // typed funcAdapters only
+    };
+    class FrozenAdapters;
+
+    // Adapter maps are never modified once published
+    struct Registry {
+        AdapterMap formatAdapter;
+        AdapterMap labelAdapter;
+        FuncMap funcAdapter;
+        std::unordered_map<std::string, FuncTypeCheck> funcTypes; // keys of funcAdapter from installTypedFuncAdapter
+        std::shared_ptr<const FrozenAdapters> frozen; // index over the maps above, see freeze()
+
+        // One probe when frozen, otherwise only the maps named in kinds are searched
+        AdapterEntry lookup(std::string_view name, unsigned kinds) const {
+#ifdef ALLOW_PROFILE_ASULFORMATSTRING
+            ++profileLookups();
+#endif
+            if (frozen) {
+                const AdapterEntry *e = frozen->find(name);
+                return e ? *e : AdapterEntry();
+            }
+            AdapterEntry e;
+            std::string key(name);
+            if (kinds & AdapterEntry::Label) {
+                auto it = labelAdapter.find(key);
+                if (it != labelAdapter.end()) { e.kinds |= AdapterEntry::Label; e.label = &it->second; }
+            }
+            if (kinds & AdapterEntry::Format) {
+                auto it = formatAdapter.find(key);
+                if (it != formatAdapter.end()) { e.kinds |= AdapterEntry::Format; e.format = &it->second; }
+            }
+            if (kinds & AdapterEntry::Func) {
+                auto it = funcAdapter.find(key);
+                if (it != funcAdapter.end()) {
+                    e.kinds |= AdapterEntry::Func;
+                    e.func = &it->second;
+                    auto typed = funcTypes.find(key);
+                    if (typed != funcTypes.end()) e.accepts = &typed->second;
+                }
+            }
+            return e;
+        }
+    };
+
+    // Hash and displace perfect hash: a key's bucket picks a seed, the seed picks its slot.
+    // Seeds are searched at build time so that every key lands in a slot of its own.
+    class FrozenAdapters {
+    public:
+        static std::shared_ptr<const FrozenAdapters> build(const Registry &reg) {
+            std::unordered_map<std::string_view, AdapterEntry> merged;
+            for (const auto &[key, value] : reg.labelAdapter) {
+                AdapterEntry &e = merged[key];
+                e.kinds |= AdapterEntry::Label;
+                e.label = &value;
+            }
+            for (const auto &[key, value] : reg.formatAdapter) {
+                AdapterEntry &e = merged[key];
+                e.kinds |= AdapterEntry::Format;
+                e.format = &value;
+            }
+            for (const auto &[key, value] : reg.funcAdapter) {
+                AdapterEntry &e = merged[key];
+                e.kinds |= AdapterEntry::Func;
+                e.func = &value;
+                auto typed = reg.funcTypes.find(key);
+                if (typed != reg.funcTypes.end()) e.accepts = &typed->second;
+            }
+            auto frozen = std::make_shared<FrozenAdapters>();
+            if (merged.empty()) return frozen;
+
+            size_t n = merged.size();
+            std::vector<AdapterEntry> keys;
+            std::vector<uint64_t> hashes;
+            keys.reserve(n);
+            hashes.reserve(n);
+            for (auto &[key, e] : merged) {
+                e.name = key;
+                keys.push_back(e);
+                hashes.push_back(hash(key));
+            }
+            // ~4 keys per bucket, table at 80% load
+            frozen->seeds.assign((n + 3) / 4, 0);
+            frozen->entries.assign(n + n / 4 + 1, AdapterEntry());
+            std::vector<std::vector<uint32_t> > buckets(frozen->seeds.size());
+            for (size_t k = 0; k < n; ++k) buckets[hashes[k] % buckets.size()].push_back(static_cast<uint32_t>(k));
+            std::vector<uint32_t> order(buckets.size());
+            for (size_t b = 0; b < order.size(); ++b) order[b] = static_cast<uint32_t>(b);
+            std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+            std::vector<size_t> slots;
+            for (uint32_t b : order) {
+                if (buckets[b].empty()) break;
+                bool placed = false;
+                for (uint32_t seed = 0; seed < (1u << 20) && !placed; ++seed) {
+                    slots.clear();
+                    placed = true;
+                    for (uint32_t k : buckets[b]) {
+                        size_t slot = frozen->slotOf(hashes[k], seed);
+                        if (frozen->entries[slot].kinds || std::find(slots.begin(), slots.end(), slot) != slots.end()) { placed = false; break; }
+                        slots.push_back(slot);
+                    }
+                    if (placed) frozen->seeds[b] = seed;
+                }
+                if (!placed) return nullptr;
+                for (size_t k = 0; k < slots.size(); ++k) frozen->entries[slots[k]] = keys[buckets[b][k]];
+            }
+            return frozen;
+        }
+        const AdapterEntry *find(std::string_view name) const {
+            if (seeds.empty()) return nullptr;
+            uint64_t h = hash(name);
+            const AdapterEntry &e = entries[slotOf(h, seeds[h % seeds.size()])];
+            return e.kinds && e.name == name ? &e : nullptr;
+        }
+        size_t size() const { return entries.size(); }
+    private:
+        std::vector<uint32_t> seeds;
+        std::vector<AdapterEntry> entries;
+
+        static uint64_t hash(std::string_view s) {
+            uint64_t h = 14695981039346656037ull; // FNV-1a
+            for (unsigned char c : s) h = (h ^ c) * 1099511628211ull;
+            return h;
+        }
+        size_t slotOf(uint64_t h, uint32_t seed) const {
+            uint64_t x = h + (seed + 1) * 0x9E3779B97F4A7C15ull; // splitmix64 finalizer
+            x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+            x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+            return static_cast<size_t>((x ^ (x >> 31)) % entries.size());
+        }
+    };
+
+    std::atomic<Sink*> printSink{nullptr};
+
+    void writePrinted(const std::string &output) {
+        if (Sink *sink = printSink.load(std::memory_order_acquire)) sink->write(output);
+        else std::cout << output;
+    }
+    // The print target as a sink, for output that goes out in pieces (print_rows)
+    class PrintTargetSink : public Sink {
+    public:
+        using Sink::write;
+        explicit PrintTargetSink(const AsulFormatString &afs) : afs(afs) {}
+        void write(const char *data, size_t size) override {
+            if (Sink *sink = afs.getPrintSink()) sink->write(data, size);
+            else std::cout.write(data, static_cast<std::streamsize>(size));
+        }
+    private:
+        const AsulFormatString &afs;
+    };
+
+    struct FormatState {
+        bool left = false;
+        bool right = false;
         int width = 0;
         bool widthTemp = false;
         char fillChar = ' ';
         int precision = -1;
         bool fixedFmt = false;
         bool scientificFmt = false;
+        std::string_view join = ", "; // between range elements, set by [[JOIN:sep]]
         void reset() {
             left = right = false;
             width = 0; widthTemp = false;
             fillChar = ' ';
             precision = -1;
             fixedFmt = scientificFmt = false;
+            join = ", ";
+        }
+    };
+
+    // Borrowed view of one argument, valid for the duration of a single f()/print() call
+    struct FormatArg {
+        enum Kind : unsigned char { Int, Double, String, Bool, Char, Any, Object, Custom, Int64, UInt64, LongDouble, Pointer, Range };
+        struct StringRef { const char *data; size_t size; };
+        struct ObjectRef { const void *ptr; void (*convert)(const void *, VariantType &); };
+        // A type with an AsulFormatter; one table per type, see customOps()
+        struct CustomOps {
+            void (*write)(const void *, Sink &);
+            void (*convert)(const void *, VariantType &);
+        };
+        struct CustomRef { const void *ptr; const CustomOps *ops; };
+        // A container / array; one table per type, see rangeOps()
+        struct RangeOps {
+            void (*write)(const void *, FormatState &, Sink &);
+            void (*convert)(const void *, VariantType &);
+        };
+        struct RangeRef { const void *ptr; const RangeOps *ops; };
+        Kind kind = Int;
+        union {
+            int i;
+            double d;
+            bool b;
+            char c;
+            long long ll;
+            unsigned long long ull;
+            const long double *ld; // borrowed, keeps the union at 16 bytes
+            const void *ptr;
+            StringRef str;
+            const std::any *any;
+            ObjectRef obj;
+            CustomRef custom;
+            RangeRef range;
+        };
+        FormatArg() : i(0) {}
+
+        // funcAdapters and [[...]] tokens still take a VariantType. Kinds it has no alternative
+        // for arrive as their default text, as they did when they were streamed.
+        VariantType toVariant() const {
+            switch (kind) {
+                case Int64:
+                case UInt64:
+                case LongDouble:
+                case Pointer: {
+                    std::string s;
+                    StringSink sink(s);
+                    FormatState fs;
+                    formatArgWithModifiers(*this, fs, sink);
+                    return VariantType(std::in_place_type<std::string>, std::move(s));
+                }
+                case Int: return VariantType(std::in_place_type<int>, i);
+                case Double: return VariantType(std::in_place_type<double>, d);
+                case String: return VariantType(std::in_place_type<std::string>, str.data, str.size);
+                case Bool: return VariantType(std::in_place_type<bool>, b);
+                case Char: return VariantType(std::in_place_type<char>, c);
+                case Any: return VariantType(std::in_place_type<std::any>, *any);
+                case Object: break;
+                case Custom: {
+                    VariantType v;
+                    custom.ops->convert(custom.ptr, v);
+                    return v;
+                }
+                case Range: {
+                    VariantType v;
+                    range.ops->convert(range.ptr, v);
+                    return v;
+                }
+            }
+            VariantType v;
+            obj.convert(obj.ptr, v);
+            return v;
+        }
+        // What a {} inside a [[...]] token expands to
+        std::string text() const {
+            if (kind != Custom && kind != Range) return variantToString(toVariant());
+            std::string s;
+            StringSink sink(s);
+            if (kind == Custom) {
+                custom.ops->write(custom.ptr, sink);
+            } else {
+                FormatState fs;
+                range.ops->write(range.ptr, fs, sink);
+            }
+            return s;
+        }
+    };
+    struct ArgList {
+        const FormatArg *data;
+        size_t size;
+    };
+
+    // One step of a compiled format string. Adapter expansion, validation and
+    // [[...]] parsing happen once at compile time; only argument dependent work is left.
+    struct CompiledOp {
+        enum Kind : unsigned char {
+            Literal,       // text is appended verbatim
+            Arg,           // next argument, formatted with the current FormatState
+            Func,          // funcAdapter consuming the next argument
+            Directive,     // pre-parsed [[...]] state change
+            LateDirective, // [[...]] token using {} / adapters, resolved on every call
+            Error          // FormatError(CompiledFormat::issue) raised when reached
+        };
+        enum DirectiveKind : unsigned char { Left, Right, Reset, Fixed, Scientific, Width, Fill, Precision, Join };
+        Kind kind = Literal;
+        DirectiveKind directive = Left;
+        bool resetsWidth = false; // literal shows plain chars, which end a temporary SETW
+        int value = 0;
+        size_t offset = 0; // LateDirective / Func: byte in the format string, for errors
+        std::string text; // Literal text, Join separator, Func name, LateDirective token
+        FuncMap::mapped_type func;
+        FuncTypeCheck accepts; // Func from installTypedFuncAdapter<T>
+    };
+    struct CompiledFormat {
+        std::vector<CompiledOp> ops;
+        FormatIssue issue; // set together with the Error op that ends ops
+        void append(std::string_view s, bool resetsWidth) {
+            if (ops.empty() || ops.back().kind != CompiledOp::Literal) ops.emplace_back();
+            ops.back().text += s;
+            ops.back().resetsWidth = ops.back().resetsWidth || resetsWidth;
+        }
+        void append(char c, bool resetsWidth) { append(std::string_view(&c, 1), resetsWidth); }
+        void push(CompiledOp op) {
+            if (op.kind == CompiledOp::Literal) {
+                append(op.text, op.resetsWidth);
+                return;
+            }
+            // a literal taking no columns (the escape of a color adapter) keeps a SETW for the
+            // {} after it
+            if (!ops.empty() && ops.back().kind == CompiledOp::Literal && ops.back().resetsWidth)
+                ops.back().resetsWidth = DisplayWidth::of(ops.back().text) > 0;
+            ops.push_back(std::move(op));
+        }
+        void fail(FormatIssue problem) {
+            issue = std::move(problem);
+            CompiledOp op;
+            op.kind = CompiledOp::Error;
+            ops.push_back(std::move(op));
+        }
+    };
+
+    // LRU of compiled formats keyed by the raw format string
+    class FormatCache {
+    public:
+        static constexpr size_t defaultCapacity = 1024;
+        size_t capacity = defaultCapacity;
+        size_t hits = 0, misses = 0, evictions = 0;
+
+        std::shared_ptr<const CompiledFormat> find(std::string_view fmt) {
+            auto it = index.find(fmt);
+            if (it == index.end()) { ++misses; return nullptr; }
+            ++hits;
+            entries.splice(entries.begin(), entries, it->second);
+            return it->second->second;
+        }
+        void insert(std::string_view fmt, std::shared_ptr<const CompiledFormat> cf) {
+            if (capacity == 0) return;
+            shrinkTo(capacity - 1);
+            entries.emplace_front(std::string(fmt), std::move(cf));
+            index.emplace(entries.front().first, entries.begin());
+        }
+        void setCapacity(size_t n) {
+            capacity = n;
+            shrinkTo(n);
+        }
+        void clear() {
+            index.clear();
+            entries.clear();
+        }
+        size_t size() const { return entries.size(); }
+    private:
+        using Entry = std::pair<std::string, std::shared_ptr<const CompiledFormat> >;
+        std::list<Entry> entries;
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+        void shrinkTo(size_t n) {
+            while (entries.size() > n) {
+                index.erase(entries.back().first);
+                entries.pop_back();
+                ++evictions;
+            }
+        }
+    };
+
+    // Current snapshot. Writers serialize on writeMutex; publishMutex only guards the pointer
+    // swap and the rare refresh of a thread that saw a new generation.
+    std::shared_ptr<const Registry> registry = std::make_shared<const Registry>();
+    // Identifies the registry snapshot; unique across instances
+    std::atomic<uint64_t> generation{nextGeneration()};
+    std::atomic<size_t> cacheCapacity{FormatCache::defaultCapacity};
+    std::atomic<size_t> cacheInvalidations{0};
+    // Keys this instance's state in every thread; a thread drops the state of an instance
+    // whose lifetime token has expired
+    const uint64_t instanceId = nextGeneration();
+    const std::shared_ptr<const bool> lifetime = std::make_shared<const bool>(true);
+    mutable std::mutex publishMutex;
+    std::mutex writeMutex;
+
+    static uint64_t nextGeneration() {
+        static std::atomic<uint64_t> counter{0};
+        return ++counter;
+    }
+    std::shared_ptr<const Registry> loadRegistry() const {
+        std::lock_guard<std::mutex> lock(publishMutex);
+        return registry;
+    }
+    void publish(std::shared_ptr<const Registry> next) {
+        std::lock_guard<std::mutex> lock(publishMutex);
+        registry = std::move(next);
+        generation.store(nextGeneration(), std::memory_order_release);
+    }
+    template <typename Fn>
+    void updateRegistry(Fn &&change) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        auto next = std::make_shared<Registry>(*loadRegistry());
+        next->frozen.reset(); // its pointers are into the old maps; freeze() builds a new one
+        change(*next);
+        ++cacheInvalidations;
+        publish(std::move(next));
+    }
+
+    // What a thread formats with, one per instance it used: that instance's registry
+    // snapshot and its compiled formats. Only refreshed when the instance publishes a new
+    // generation, so steady state formatting takes no lock and shares no cache line with
+    // other threads, and switching between instances keeps each one's cache.
+    struct ThreadState {
+        uint64_t instance = 0;
+        std::weak_ptr<const bool> lifetime;
+        uint64_t generation = 0;
+        std::shared_ptr<const Registry> registry;
+        FormatCache cache;
+        int depth = 0; // f()/print() calls in progress, funcAdapters and operator<< may nest
+        std::vector<std::shared_ptr<const Registry> > retired; // replaced while depth > 0
+    };
+    ThreadState &threadState() const {
+        // heap entries, so a state stays put while a nested call adds another one
+        thread_local std::vector<std::unique_ptr<ThreadState> > states;
+        for (const auto &s : states) {
+            if (s->instance == instanceId) return *s;
+        }
+        states.erase(std::remove_if(states.begin(), states.end(), [](const std::unique_ptr<ThreadState> &s) {
+            return s->depth == 0 && s->lifetime.expired();
+        }), states.end());
+        auto st = std::make_unique<ThreadState>();
+        st->instance = instanceId;
+        st->lifetime = lifetime;
+        states.push_back(std::move(st));
+        return *states.back();
+    }
+    // Pins the calling thread's snapshot of one instance for the duration of a call
+    class SnapshotScope {
+    public:
+        explicit SnapshotScope(const AsulFormatString &afs) : st(afs.threadState()) {
+            uint64_t current = afs.generation.load(std::memory_order_acquire);
+            if (st.generation != current) {
+                if (st.depth > 0 && st.registry) st.retired.push_back(std::move(st.registry));
+                std::lock_guard<std::mutex> lock(afs.publishMutex);
+                st.registry = afs.registry;
+                st.generation = afs.generation.load(std::memory_order_relaxed);
+                st.cache.clear();
+            }
+            size_t capacity = afs.cacheCapacity.load(std::memory_order_relaxed);
+            if (st.cache.capacity != capacity) st.cache.setCapacity(capacity);
+            reg = st.registry.get();
+            gen = st.generation;
+            ++st.depth;
+        }
+        ~SnapshotScope() {
+            if (--st.depth == 0 && !st.retired.empty()) st.retired.clear();
+        }
+        SnapshotScope(const SnapshotScope&) = delete;
+        SnapshotScope& operator=(const SnapshotScope&) = delete;
+        const Registry &registry() const { return *reg; }
+        uint64_t generation() const { return gen; }
+        FormatCache &cache() const { return st.cache; }
+    private:
+        ThreadState &st;
+        const Registry *reg;
+        uint64_t gen;
+    };
+
+    static std::atomic<uint64_t (*)()> &allocationCounter() {
+        static std::atomic<uint64_t (*)()> counter{nullptr};
+        return counter;
+    }
+#ifdef ALLOW_PROFILE_ASULFORMATSTRING
+    // Registry lookups made by the calling thread, see Registry::lookup
+    static uint64_t &profileLookups() {
+        thread_local uint64_t lookups = 0;
+        return lookups;
+    }
+    // One table per thread and instance. Only its thread writes it, so the mutex is only
+    // contended by stats().
+    struct ThreadProfile {
+        std::mutex mutex;
+        std::unordered_map<std::string_view, std::unique_ptr<FormatStats> > formats; // keys view FormatStats::format
+        FormatStats &entry(std::string_view fmt) {
+            auto it = formats.find(fmt);
+            if (it == formats.end()) {
+                auto s = std::make_unique<FormatStats>();
+                s->format = std::string(fmt);
+                std::string_view key = s->format;
+                it = formats.emplace(key, std::move(s)).first;
+            }
+            return *it->second;
+        }
+    };
+    static void mergeStats(FormatStats &m, const FormatStats &s) {
+        m.calls += s.calls;
+        m.totalNs += s.totalNs;
+        m.maxNs = std::max(m.maxNs, s.maxNs);
+        m.outputBytes += s.outputBytes;
+        m.argsConsumed += s.argsConsumed;
+        m.adapterLookups += s.adapterLookups;
+        m.allocations += s.allocations;
+    }
+    // The tables of one instance. Threads only hold a weak_ptr to it, so one that exits
+    // after the instance is gone finds nothing to merge into.
+    struct ProfileTables {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadProfile> > live; // threads still running
+        ThreadProfile exited;                               // counts of threads that exited
+    };
+    std::shared_ptr<ProfileTables> profiles = std::make_shared<ProfileTables>();
+    const uint64_t profileId = nextGeneration();
+    // The calling thread's tables. When the thread exits each one is merged into the
+    // exited counts of its instance and freed, so short-lived threads leave no table behind.
+    struct ThreadProfiles {
+        struct Entry {
+            uint64_t id;
+            std::weak_ptr<ProfileTables> tables;
+            ThreadProfile *profile;
+        };
+        std::vector<Entry> entries;
+        ThreadProfiles() = default;
+        ThreadProfiles(const ThreadProfiles&) = delete;
+        ThreadProfiles& operator=(const ThreadProfiles&) = delete;
+        ~ThreadProfiles() {
+            for (const Entry &e : entries) {
+                std::shared_ptr<ProfileTables> pt = e.tables.lock();
+                if (!pt) continue;
+                std::lock_guard<std::mutex> lock(pt->mutex);
+                for (const auto &f : e.profile->formats) mergeStats(pt->exited.entry(f.first), *f.second);
+                auto it = std::find_if(pt->live.begin(), pt->live.end(), [&](const std::unique_ptr<ThreadProfile> &p) {
+                    return p.get() == e.profile;
+                });
+                if (it != pt->live.end()) pt->live.erase(it);
+            }
+        }
+    };
+    ThreadProfile &threadProfile() {
+        // ids are never reused, so the entry of a destroyed instance never matches again
+        thread_local ThreadProfiles mine;
+        for (const auto &m : mine.entries) {
+            if (m.id == profileId) return *m.profile;
+        }
+        // their tables went with their instance
+        mine.entries.erase(std::remove_if(mine.entries.begin(), mine.entries.end(), [](const ThreadProfiles::Entry &e) {
+            return e.tables.expired();
+        }), mine.entries.end());
+        std::lock_guard<std::mutex> lock(profiles->mutex);
+        profiles->live.push_back(std::make_unique<ThreadProfile>());
+        mine.entries.push_back({profileId, profiles, profiles->live.back().get()});
+        return *profiles->live.back();
+    }
+    // Measures one print(sink, ...) call and adds it to the thread's table on the way out
+    class ProfileCall {
+    public:
+        ProfileCall(AsulFormatString &afs, std::string_view fmt, Sink &target)
+            : afs(afs), fmt(fmt), counted(target), counter(allocationCounter().load(std::memory_order_acquire)),
+              allocs0(counter ? counter() : 0), lookups0(profileLookups()), t0(std::chrono::steady_clock::now()) {}
+        ~ProfileCall() {
+            uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - t0).count());
+            uint64_t allocs = counter ? counter() - allocs0 : 0;
+            uint64_t lookups = profileLookups() - lookups0;
+#ifdef ASUL_FORMAT_STRING_EXCEPTIONS
+            try {
+                record(ns, allocs, lookups);
+            } catch (...) {
+                // a profile that cannot be recorded must not fail the print
+            }
+#else
+            record(ns, allocs, lookups);
+#endif
+        }
+        ProfileCall(const ProfileCall&) = delete;
+        ProfileCall& operator=(const ProfileCall&) = delete;
+        Sink &sink() { return counted; }
+        void consumed(size_t n) { args = n; }
+    private:
+        void record(uint64_t ns, uint64_t allocs, uint64_t lookups) {
+            ThreadProfile &tp = afs.threadProfile();
+            std::lock_guard<std::mutex> lock(tp.mutex);
+            FormatStats &s = tp.entry(fmt);
+            ++s.calls;
+            s.totalNs += ns;
+            s.maxNs = std::max(s.maxNs, ns);
+            s.outputBytes += counted.bytes;
+            s.argsConsumed += args;
+            s.adapterLookups += lookups;
+            s.allocations += allocs;
+        }
+        class CountingSink : public Sink {
+        public:
+            using Sink::write;
+            explicit CountingSink(Sink &target) : target(target) {}
+            void write(const char *data, size_t size) override { bytes += size; target.write(data, size); }
+            void flush() override { target.flush(); }
+            Sink &target;
+            uint64_t bytes = 0;
+        };
+        AsulFormatString &afs;
+        std::string_view fmt;
+        CountingSink counted;
+        uint64_t (*counter)();
+        uint64_t allocs0;
+        uint64_t lookups0;
+        std::chrono::steady_clock::time_point t0;
+        size_t args = 0;
+    };
+#else
+    class ProfileCall {
+    public:
+        ProfileCall(const AsulFormatString &, std::string_view, Sink &target) : target(target) {}
+        Sink &sink() { return target; }
+        void consumed(size_t) {}
+    private:
+        Sink &target;
+    };
+#endif
+
+    std::shared_ptr<const CompiledFormat> compiledFormat(std::string_view fmt, const SnapshotScope &scope) {
+        FormatCache &cache = scope.cache();
+        if (std::shared_ptr<const CompiledFormat> cf = cache.find(fmt)) return cf;
+        std::shared_ptr<const CompiledFormat> cf = compileFormat(std::string(fmt), scope.registry());
+        cache.insert(fmt, cf);
+        return cf;
+    }
+
+    // One pass over the raw format for all three bracket kinds, before any adapter is
+    // expanded. Unpaired closers are ignored except ']]'; doubled {{ }} (( )) are escapes
+    // and '[' right after ESC belongs to an ANSI sequence. Depths are plain counters, the
+    // offsets of the innermost openers are kept for the message.
+    static FormatIssue checkBrackets(std::string_view fmt) {
+        struct Depth {
+            enum : size_t { tracked = 32 };
+            size_t depth = 0;
+            size_t opened[tracked] = {};
+            void open(size_t at) { if (depth < tracked) opened[depth] = at; ++depth; }
+            void close() { if (depth) --depth; }
+            size_t innermost() const { return opened[std::min<size_t>(depth, tracked) - 1]; }
+        } paren, curly, square;
+        size_t strayClose = std::string::npos; // first ']]' without '[['
+        for (size_t i = MetaScanner::find(fmt, 0); i < fmt.size(); i = MetaScanner::find(fmt, i + 1)) {
+            char c = fmt[i];
+            bool doubled = i + 1 < fmt.size() && fmt[i + 1] == c;
+            switch (c) {
+                case '(': if (doubled) ++i; else paren.open(i); break;
+                case ')': if (doubled) ++i; else paren.close(); break;
+                case '{': if (doubled) ++i; else curly.open(i); break;
+                case '}': if (doubled) ++i; else curly.close(); break;
+                case '[':
+                    if (i > 0 && fmt[i - 1] == '\033') break;
+                    if (doubled) { square.open(i); ++i; }
+                    break;
+                case ']':
+                    if (!doubled) break;
+                    if (!square.depth && strayClose == std::string::npos) strayClose = i;
+                    square.close();
+                    ++i;
+                    break;
+                default: break;
+            }
+        }
+        auto issue = [](const char *message, size_t at, const char *token) {
+            return FormatIssue{std::string(message) + " (at byte " + std::to_string(at) + ")", at, token, FormatIssue::Brackets};
+        };
+        if (paren.depth) return issue("Mismatched parentheses in format string: unclosed '('", paren.innermost(), "(");
+        if (curly.depth) return issue("Mismatched curly braces in format string: unclosed '{'", curly.innermost(), "{");
+        if (strayClose != std::string::npos) return issue("Mismatched square brackets in format string: ']]' without '[['", strayClose, "]]");
+        if (square.depth) return issue("Mismatched square brackets in format string: unclosed '[['", square.innermost(), "[[");
+        return FormatIssue();
+    }
+
+    // The input of compileFormat / processInnerInToken: the format with adapter values spliced
+    // in as they are found, kept as a stack of pending segments. Expanding a reference pushes
+    // its value instead of rebuilding the rest of the string, so nothing is copied twice.
+    // Offsets are relative to the read position and may span segments.
+    class ExpansionStack {
+    public:
+        enum : unsigned { maxDepth = 32 }; // adapters that expand into themselves stop here
+
+        explicit ExpansionStack(std::string_view text) { push(text, 0, 0); }
+        bool done() const { return segments.empty(); }
+        char peek(size_t k = 0) const {
+            for (auto s = segments.rbegin(); s != segments.rend(); ++s) {
+                size_t left = s->text.size() - s->pos;
+                if (k < left) return s->text[s->pos + k];
+                k -= left;
+            }
+            return '\0';
+        }
+        bool is(size_t k, char c) const { return k < remaining() && peek(k) == c; }
+        size_t remaining() const {
+            size_t n = 0;
+            for (const Segment &s : segments) n += s.text.size() - s.pos;
+            return n;
+        }
+        size_t find(char c, size_t from) const {
+            size_t base = 0;
+            for (auto s = segments.rbegin(); s != segments.rend(); ++s) {
+                std::string_view left = s->text.substr(s->pos);
+                if (from < base + left.size()) {
+                    size_t j = left.find(c, from > base ? from - base : 0);
+                    if (j != std::string_view::npos) return base + j;
+                }
+                base += left.size();
+            }
+            return std::string_view::npos;
+        }
+        size_t find(std::string_view pair, size_t from) const { // two bytes, e.g. "]]"
+            for (size_t j = find(pair[0], from); j != std::string_view::npos; j = find(pair[0], j + 1)) {
+                if (is(j + 1, pair[1])) return j;
+            }
+            return std::string_view::npos;
+        }
+        // Bytes [from, to) ahead; a view into the segment when they lie in one, else copied into scratch
+        std::string_view text(size_t from, size_t to, std::string &scratch) const {
+            const Segment &top = segments.back();
+            if (to <= top.text.size() - top.pos) return top.text.substr(top.pos + from, to - from);
+            scratch.clear();
+            for (size_t k = from; k < to; ++k) scratch += peek(k);
+            return scratch;
+        }
+        // What is left of the current segment, never empty while !done()
+        std::string_view run() const { return segments.back().text.substr(segments.back().pos); }
+        void skip(size_t n) {
+            while (n > 0 && !segments.empty()) {
+                Segment &s = segments.back();
+                size_t step = std::min(n, s.text.size() - s.pos);
+                s.pos += step;
+                n -= step;
+                if (s.pos == s.text.size()) segments.pop_back();
+            }
+        }
+        // Byte of the original format the read position comes from; spliced text maps to
+        // the outermost reference it replaced
+        size_t origin() const {
+            const Segment &s = segments.back();
+            return s.depth == 0 ? s.pos : s.origin;
+        }
+        // Replaces the n byte reference at the read position with value, which is read next.
+        // value must outlive the stack. False, with nothing consumed, if nested too deep.
+        bool expand(size_t n, std::string_view value) {
+            unsigned depth = segments.back().depth + 1;
+            if (depth > maxDepth) return false;
+            size_t at = origin();
+            skip(n);
+            push(value, depth, at);
+            return true;
+        }
+        bool expandOwned(size_t n, std::string value) {
+            owned.push_back(std::move(value));
+            return expand(n, std::string_view(owned.back()));
+        }
+    private:
+        struct Segment {
+            std::string_view text;
+            size_t pos;
+            size_t origin;
+            unsigned depth;
+        };
+        std::vector<Segment> segments; // back() is read first
+        std::list<std::string> owned;  // argument text spliced into [[...]] tokens
+        void push(std::string_view text, unsigned depth, size_t at) {
+            if (!text.empty()) segments.push_back(Segment{text, 0, at, depth});
+        }
+    };
+
+    // Adapters are spliced into the input and rescanned, [[...]] drives FormatState
+    static std::shared_ptr<const CompiledFormat> compileFormat(const std::string &fmt, const Registry &reg) {
+        auto cf = std::make_shared<CompiledFormat>();
+        FormatIssue brackets = checkBrackets(fmt);
+        if (!brackets.ok()) {
+            cf->fail(std::move(brackets));
+            return cf;
+        }
+
+        ExpansionStack in(fmt);
+        std::string scratch;
+        auto fail = [&](std::string message, std::string token, FormatIssue::Code code) {
+            size_t at = in.origin();
+            cf->fail(FormatIssue{message + " (at byte " + std::to_string(at) + ")", at, std::move(token), code});
+        };
+        auto splice = [&](size_t n, std::string_view value) {
+            if (in.expand(n, value)) return true;
+            fail("Adapter expansion nested deeper than " + std::to_string(ExpansionStack::maxDepth) + " levels, does an adapter refer to itself?",
+                 std::string(in.text(0, n, scratch)), FormatIssue::Adapter);
+            return false;
+        };
+        while (!in.done()) {
+            char c = in.peek();
+            if (c == '{' && in.is(1, '{')) {
+                cf->append('{', false);
+                in.skip(2);
+                continue;
+            }
+            if (c == '(' && in.is(1, '(')) {
+                cf->append('(', false);
+                in.skip(2);
+                continue;
+            }
+            if (c == '[') {
+                if (in.is(1, '[')) {
+                    size_t j = in.find("]]", 2);
+                    if (j == std::string::npos) {
+                        bool looksLikeCSI = false;
+                        size_t lookEnd = std::min(in.remaining(), (size_t)20);
+                        for (size_t kk = 1; kk < lookEnd; ++kk) {
+                            unsigned char ch2 = static_cast<unsigned char>(in.peek(kk));
+                            if ((ch2 >= 'A' && ch2 <= 'Z') || (ch2 >= 'a' && ch2 <= 'z')) { looksLikeCSI = true; break; }
+                        }
+                        if (looksLikeCSI) {
+                            cf->append('[', false);
+                            in.skip(1);
+                            continue;
+                        }
+
+                        std::string_view tail = in.text(0, std::min<size_t>(80, in.remaining()), scratch);
+                        std::ostringstream _oss;
+                        _oss << "Unclosed '[[' in format string: '";
+                        for (unsigned char ch : tail) {
+                            if (ch >= 32 && ch <= 126) _oss << ch;
+                            else { _oss << "\\x" << std::hex << std::uppercase << (int)ch << std::dec; }
+                        }
+                        _oss << "'";
+                        fail(_oss.str(), "[[", FormatIssue::Brackets);
+                        return cf;
+                    }
+                    std::string token(in.text(2, j, scratch));
+                    if (token.empty()) {
+                        fail("Empty [[]] directive is not allowed", "[[]]", FormatIssue::Directive);
+                        return cf;
+                    }
+                    if (token.find_first_of("{(") != std::string::npos) {
+                        CompiledOp op;
+                        op.kind = CompiledOp::LateDirective;
+                        op.offset = in.origin();
+                        op.text = token;
+                        cf->push(std::move(op));
+                    } else {
+                        CompiledOp op = parseDirective(token);
+                        if (op.kind == CompiledOp::Error) {
+                            fail(op.text, "[[" + token + "]]", FormatIssue::Directive);
+                            return cf;
+                        }
+                        cf->push(std::move(op));
+                    }
+                    in.skip(j + 2);
+                    continue;
+                } else {
+                    cf->append('[', false);
+                    in.skip(1);
+                    continue;
+                }
+            }
+
+            if (c == '(') {
+                size_t j = in.find(')', 0);
+                if (j == std::string::npos) {
+                    cf->append('(', false);
+                    in.skip(1);
+                    continue;
+                }
+                AdapterEntry e = reg.lookup(in.text(1, j, scratch), AdapterEntry::Label);
+                if (e.label) {
+                    if (!splice(j + 1, *e.label)) return cf;
+                    continue;
+                } else {
+                    // not a label: plain parenthesis, keep formatting what is inside
+                    cf->append('(', false);
+                    in.skip(1);
+                    continue;
+                }
+            }
+
+            if (c == '{') {
+                size_t j = in.find('}', 0);
+                if (j == std::string::npos) {
+                    cf->append('{', true);
+                    in.skip(1);
+                    continue;
+                }
+                std::string_view inner = in.text(1, j, scratch);
+                if (inner.empty()) {
+                    CompiledOp op;
+                    op.kind = CompiledOp::Arg;
+                    cf->push(std::move(op));
+                    in.skip(j + 1);
+                    continue;
+                } else {
+                    if (inner.find('[') != std::string::npos || inner.find('(') != std::string::npos) {
+                        cf->append(in.text(0, j + 1, scratch), false);
+                        in.skip(j + 1);
+                        continue;
+                    }
+                    AdapterEntry e = reg.lookup(inner, AdapterEntry::Func | AdapterEntry::Format);
+                    if (e.func) {
+                        CompiledOp op;
+                        op.kind = CompiledOp::Func;
+                        op.offset = in.origin();
+                        op.text = inner;
+                        op.func = *e.func;
+                        if (e.accepts) op.accepts = *e.accepts;
+                        cf->push(std::move(op));
+                        in.skip(j + 1);
+                        continue;
+                    }
+                    if (e.format) {
+                        if (!splice(j + 1, *e.format)) return cf;
+                        continue;
+                    } else {
+                        cf->append(in.text(0, j + 1, scratch), false);
+                        in.skip(j + 1);
+                        continue;
+                    }
+                }
+            }
+
+            // plain text up to the next byte that may start syntax
+            std::string_view run = in.run();
+            size_t j = MetaScanner::find(run, 1);
+            cf->append(run.substr(0, j), true);
+            in.skip(j);
+        }
+        return cf;
+    }
+
+    // What std::stoi accepts (leading blanks, one sign, trailing text ignored), read with
+    // std::from_chars so a bad value costs a return code instead of an exception
+    static bool parseInt(std::string_view v, int &out) {
+        size_t i = 0;
+        while (i < v.size() && (v[i] == ' ' || (v[i] >= '\t' && v[i] <= '\r'))) ++i;
+        if (i < v.size() && v[i] == '+') {
+            ++i;
+            if (i < v.size() && v[i] == '-') return false; // "+-5" is not a number for stoi
+        }
+        std::from_chars_result r = std::from_chars(v.data() + i, v.data() + v.size(), out);
+        return r.ec == std::errc();
+    }
+
+    // Parses a [[...]] token whose adapters / {} have already been resolved.
+    // ENDL comes back as a Literal, problems as an Error op.
+    static CompiledOp parseDirective(const std::string &token) {
+        CompiledOp op;
+        op.kind = CompiledOp::Directive;
+        if (token == "LEFT") op.directive = CompiledOp::Left;
+        else if (token == "RIGHT") op.directive = CompiledOp::Right;
+        else if (token == "RESET") op.directive = CompiledOp::Reset;
+        else if (token == "FIXED") op.directive = CompiledOp::Fixed;
+        else if (token == "SCIENTIFIC") op.directive = CompiledOp::Scientific;
+        else if (token == "ENDL") { op.kind = CompiledOp::Literal; op.text = "\n"; }
+        else {
+            auto pos = token.find(':');
+            if (pos != std::string::npos) {
+                std::string key = token.substr(0, pos);
+                std::string val = token.substr(pos + 1);
+                if (key == "SETW") {
+                    op.directive = CompiledOp::Width;
+                    if (val.empty()) { op.kind = CompiledOp::Error; op.text = "SETW requires a numeric value inside [[]]"; return op; }
+                    if (!parseInt(val, op.value)) { op.kind = CompiledOp::Error; op.text = "Invalid integer for SETW inside [[]]: '" + val + "'"; }
+                } else if (key == "FILL") {
+                    op.directive = CompiledOp::Fill;
+                    if (val.empty()) { op.kind = CompiledOp::Error; op.text = "FILL requires a character inside [[]]"; return op; }
+                    op.value = val[0];
+                } else if (key == "PREC") {
+                    op.directive = CompiledOp::Precision;
+                    if (val.empty()) { op.kind = CompiledOp::Error; op.text = "PREC requires a numeric value inside [[]]"; return op; }
+                    if (!parseInt(val, op.value)) { op.kind = CompiledOp::Error; op.text = "Invalid integer for PREC inside [[]]: '" + val + "'"; }
+                } else if (key == "JOIN") {
+                    // an empty separator is allowed and runs the elements together
+                    op.directive = CompiledOp::Join;
+                    op.text = val;
+                } else {
+                    op.kind = CompiledOp::Error;
+                    op.text = std::string("Unknown [[]] directive: [[") + token + "]]";
+                }
+            } else {
+                op.kind = CompiledOp::Error;
+                op.text = std::string("Unknown [[]] directive: [[") + token + "]]";
+            }
+        }
+        return op;
+    }
+
+    static void applyDirective(const CompiledOp &op, FormatState &fs) {
+        switch (op.directive) {
+            case CompiledOp::Left: fs.left = true; fs.right = false; break;
+            case CompiledOp::Right: fs.right = true; fs.left = false; break;
+            case CompiledOp::Reset: fs.reset(); break;
+            case CompiledOp::Fixed: fs.fixedFmt = true; fs.scientificFmt = false; break;
+            case CompiledOp::Scientific: fs.scientificFmt = true; fs.fixedFmt = false; break;
+            case CompiledOp::Width: fs.width = op.value; fs.widthTemp = true; break;
+            case CompiledOp::Fill: fs.fillChar = static_cast<char>(op.value); break;
+            case CompiledOp::Precision: fs.precision = op.value; break;
+            case CompiledOp::Join: fs.join = op.text; break;
+        }
+    }
+
+    // Collects the rows of print_rows and hands them on in 64 KiB pieces. Only whole rows
+    // leave it: what was written since the last endRow() stays buffered, a row longer than
+    // a piece included, and dropRow() discards it.
+    class ChunkSink final : public Sink {
+    public:
+        using Sink::write;
+        explicit ChunkSink(Sink &target) : target(target) { buf.reserve(capacity); }
+        void write(const char *data, size_t size) override {
+            if (buf.size() + size > capacity && rowStart > 0) {
+                target.write(buf.data(), rowStart);
+                buf.erase(0, rowStart);
+                rowStart = 0;
+            }
+            buf.append(data, size);
+        }
+        void endRow() { rowStart = buf.size(); }
+        void dropRow() { buf.resize(rowStart); }
+        void flush() override {
+            if (!buf.empty()) target.write(buf.data(), buf.size());
+            buf.clear();
+            rowStart = 0;
+        }
+    private:
+        static constexpr size_t capacity = 64 * 1024;
+        Sink &target;
+        std::string buf;
+        size_t rowStart = 0; // end of the last whole row in buf
+    };
+    template <typename T, typename = void>
+    struct isTupleLike : std::false_type {};
+    template <typename T>
+    struct isTupleLike<T, std::void_t<decltype(std::tuple_size<T>::value)> > : std::true_type {};
+    template <typename T>
+    struct isColumnView : std::false_type {};
+    template <typename... Columns>
+    struct isColumnView<ColumnView<Columns...> > : std::true_type {};
+
+    template <typename Rows>
+    static size_t tableRows(const Rows &rows) {
+        if constexpr (isColumnView<Rows>::value) return rows.rows();
+        else return static_cast<size_t>(std::distance(std::begin(rows), std::end(rows)));
+    }
+    // Position of a row: an iterator, or one per column of a ColumnView
+    template <typename Rows>
+    static auto rowCursor(const Rows &rows) {
+        if constexpr (isColumnView<Rows>::value) return rows.cursor();
+        else return std::begin(rows);
+    }
+    // Calls fn(ArgList) for at most count rows from cur until it returns false; cur is left
+    // after the rows visited
+    template <typename Rows, typename Cursor, typename Fn>
+    static void forEachRow(const Rows &rows, Cursor &cur, size_t count, Fn &&fn) {
+        std::vector<FormatArg> cells; // rows that are ranges, reused
+        if constexpr (isColumnView<Rows>::value) {
+            // columns have no end to check against, counts past the last row are cut here
+            rows.eachFrom([&](const auto &row) { return withRowArgs(row, cells, fn); }, cur, std::min(count, rows.rows()));
+        } else {
+            for (auto end = std::end(rows); count > 0 && cur != end; ++cur, --count) {
+                if (!withRowArgs(*cur, cells, fn)) return;
+            }
         }
+    }
+    // Cursors on the first row of every block of blockRows rows, found in one walk, so a
+    // std::list / std::map table is not walked from its start again for every block; the
+    // auto width pass and the formatting pass share them
+    template <typename Rows>
+    static auto blockCursors(const Rows &rows, size_t rowCount, size_t blockRows) {
+        auto cur = rowCursor(rows);
+        std::vector<decltype(cur)> starts;
+        if (rowCount == 0) return starts;
+        starts.reserve((rowCount + blockRows - 1) / blockRows);
+        const auto step = static_cast<std::ptrdiff_t>(blockRows);
+        for (size_t first = 0; first < rowCount; first += blockRows) {
+            if (first) {
+                if constexpr (isColumnView<Rows>::value) std::apply([&](auto&... it) { (std::advance(it, step), ...); }, cur);
+                else std::advance(cur, step);
+            }
+            starts.push_back(cur);
+        }
+        return starts;
+    }
+
+    // Parallel tables: rows are cut into blocks of at least minBlockRows, handed out in input
+    // order from one counter, so a thread that finishes early simply takes the next block.
+    static constexpr size_t minBlockRows = 64;
+    static size_t blockRowsFor(size_t rowCount, unsigned threads) {
+        return std::min<size_t>(std::max<size_t>(rowCount / (size_t(threads) * 16), minBlockRows), 8192);
+    }
+    // Runs work(first, count) over all blocks on threads threads, the caller being one of them.
+    // The first exception thrown by a block is rethrown once every thread is done.
+    template <typename Work>
+    static void forEachBlock(size_t rowCount, unsigned threads, Work &&work) {
+        const size_t blockRows = blockRowsFor(rowCount, threads);
+        std::atomic<size_t> next{0};
+#ifdef ASUL_FORMAT_STRING_EXCEPTIONS
+        std::mutex errorMutex;
+        std::exception_ptr error;
+#endif
+        auto run = [&] {
+            for (size_t first; (first = next.fetch_add(blockRows, std::memory_order_relaxed)) < rowCount; ) {
+#ifdef ASUL_FORMAT_STRING_EXCEPTIONS
+                try {
+                    work(first, std::min(blockRows, rowCount - first));
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (!error) error = std::current_exception();
+                    next.store(rowCount, std::memory_order_relaxed);
+                }
+#else
+                work(first, std::min(blockRows, rowCount - first));
+#endif
+            }
+        };
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < threads; ++t) pool.emplace_back(run);
+        run();
+        for (std::thread &t : pool) t.join();
+#ifdef ASUL_FORMAT_STRING_EXCEPTIONS
+        if (error) std::rethrow_exception(error);
+#endif
+    }
+    // Workers format blocks into buffers of their own, the calling thread writes them to out
+    // in input order. At most `window` blocks are in flight, so memory stays bounded however
+    // long the table is, and the sink only ever sees the calling thread.
+    template <typename Rows, typename Cursor>
+    static FormatIssue runRowsParallel(const CompiledFormat &cf, const Registry &reg, const Rows &rows, const std::vector<Cursor> &starts,
+                                       size_t rowCount, unsigned threads, Sink &out, size_t &consumed) {
+        struct Block {
+            std::string text; // capacity reused by the blocks that take this slot later
+            FormatIssue issue;
+            size_t consumed = 0;
+            bool ready = false;
+#ifdef ASUL_FORMAT_STRING_EXCEPTIONS
+            std::exception_ptr error;
+#endif
+        };
+        struct Shared {
+            std::mutex mutex;
+            std::condition_variable readyCv, freeCv;
+            size_t next = 0, written = 0;
+            bool stop = false;
+        } sh;
+        const size_t blockRows = blockRowsFor(rowCount, threads);
+        const size_t blocks = (rowCount + blockRows - 1) / blockRows;
+        const size_t window = size_t(threads) * 4;
+        std::vector<Block> slots(window);
+
+        auto worker = [&] {
+            for (;;) {
+                size_t b;
+                {
+                    std::unique_lock<std::mutex> lock(sh.mutex);
+                    sh.freeCv.wait(lock, [&] { return sh.stop || sh.next >= blocks || sh.next < sh.written + window; });
+                    if (sh.stop || sh.next >= blocks) return;
+                    b = sh.next++;
+                }
+                Block &blk = slots[b % window];
+                blk.text.clear();
+                StringSink sink(blk.text);
+                FormatIssue issue;
+                size_t used = 0;
+                auto format = [&] {
+                    auto cur = starts[b];
+                    forEachRow(rows, cur, std::min(blockRows, rowCount - b * blockRows), [&](ArgList args) {
+                        size_t rowStart = blk.text.size();
+                        used += runCompiled(cf, reg, args, sink, issue);
+                        if (!issue.ok()) blk.text.resize(rowStart); // nothing of a failing row
+                        return issue.ok();
+                    });
+                };
+#ifdef ASUL_FORMAT_STRING_EXCEPTIONS
+                try {
+                    format();
+                } catch (...) {
+                    blk.error = std::current_exception();
+                }
+#else
+                format();
+#endif
+                {
+                    std::lock_guard<std::mutex> lock(sh.mutex);
+                    blk.issue = std::move(issue);
+                    blk.consumed = used;
+                    blk.ready = true;
+                }
+                sh.readyCv.notify_all();
+            }
+        };
+        // stops and joins the workers on every way out, a throwing sink included
+        struct Pool {
+            Shared &sh;
+            std::vector<std::thread> threads;
+            ~Pool() {
+                {
+                    std::lock_guard<std::mutex> lock(sh.mutex);
+                    sh.stop = true;
+                }
+                sh.freeCv.notify_all();
+                for (std::thread &t : threads) t.join();
+            }
+        } pool{sh, {}};
+        for (unsigned t = 0; t < threads; ++t) pool.threads.emplace_back(worker);
+
+        FormatIssue issue;
+        for (size_t b = 0; b < blocks; ++b) {
+            Block &blk = slots[b % window];
+            {
+                std::unique_lock<std::mutex> lock(sh.mutex);
+                sh.readyCv.wait(lock, [&] { return blk.ready; });
+            }
+#ifdef ASUL_FORMAT_STRING_EXCEPTIONS
+            if (blk.error) std::rethrow_exception(blk.error);
+#endif
+            out.write(blk.text);
+            consumed += blk.consumed;
+            bool failed = !blk.issue.ok();
+            if (failed) issue = blk.issue;
+            {
+                std::lock_guard<std::mutex> lock(sh.mutex);
+                blk.ready = false;
+                sh.written = b + 1;
+                sh.stop = failed;
+            }
+            sh.freeCv.notify_all();
+            if (failed) break;
+        }
+        return issue;
+    }
+    template <typename Row, typename Fn>
+    static bool withRowArgs(const Row &row, std::vector<FormatArg> &cells, Fn &fn) {
+        if constexpr (isTupleLike<Row>::value) {
+            return std::apply([&](const auto&... cell) {
+                const FormatArg argv[] = {makeArg(cell)..., FormatArg()};
+                return fn(ArgList{argv, sizeof...(cell)});
+            }, row);
+        } else {
+            static_assert(isRange<Row>::value, "print_rows: a row is a tuple, pair, std::array or range with one element per {}");
+            cells.clear();
+            for (const auto &cell : row) cells.push_back(makeArg(cell));
+            return fn(ArgList{cells.data(), cells.size()});
+        }
+    }
+    // TableOptions::autoWidth: out is cf with a SETW in front of every {} that has none, as
+    // wide as its widest value over all rows under the state at that point of the template.
+    // False when a [[...]] token takes arguments, which leaves the slots of {} unknown.
+    template <typename Rows, typename Cursor>
+    static bool widenColumns(const CompiledFormat &cf, const Rows &rows, CompiledFormat &out, unsigned threads, size_t rowCount,
+                             const std::vector<Cursor> &starts) {
+        struct Slot { size_t op; FormatState state; bool measured; size_t width; };
+        std::vector<Slot> slots;
+        FormatState fs;
+        for (size_t k = 0; k < cf.ops.size(); ++k) {
+            const CompiledOp &op = cf.ops[k];
+            switch (op.kind) {
+                case CompiledOp::Literal:
+                    if (op.resetsWidth && fs.widthTemp) { fs.width = 0; fs.widthTemp = false; }
+                    break;
+                case CompiledOp::Arg:
+                    slots.push_back(Slot{k, fs, fs.width <= 0, 0});
+                    if (fs.widthTemp) { fs.width = 0; fs.widthTemp = false; }
+                    break;
+                case CompiledOp::Func:
+                    slots.push_back(Slot{k, fs, false, 0});
+                    if (fs.widthTemp) { fs.width = 0; fs.widthTemp = false; }
+                    break;
+                case CompiledOp::Directive:
+                    applyDirective(op, fs);
+                    break;
+                case CompiledOp::LateDirective:
+                    return false;
+                case CompiledOp::Error:
+                    break;
+            }
+        }
+        // in terminal columns, the unit SETW pads to
+        auto measure = [&](auto cur, size_t count, std::vector<size_t> &widths) {
+            std::string cell;
+            StringSink sink(cell);
+            forEachRow(rows, cur, count, [&](ArgList args) {
+                for (size_t s = 0; s < slots.size() && s < args.size; ++s) {
+                    if (!slots[s].measured) continue;
+                    FormatState state = slots[s].state;
+                    cell.clear();
+                    formatArgWithModifiers(args.data[s], state, sink);
+                    widths[s] = std::max(widths[s], DisplayWidth::of(cell));
+                }
+                return true;
+            });
+        };
+        std::vector<size_t> widths(slots.size(), 0);
+        if (threads > 1) {
+            std::mutex mutex;
+            const size_t blockRows = blockRowsFor(rowCount, threads);
+            forEachBlock(rowCount, threads, [&](size_t first, size_t count) {
+                std::vector<size_t> mine(slots.size(), 0);
+                measure(starts[first / blockRows], count, mine);
+                std::lock_guard<std::mutex> lock(mutex);
+                for (size_t s = 0; s < slots.size(); ++s) widths[s] = std::max(widths[s], mine[s]);
+            });
+        } else {
+            measure(rowCursor(rows), std::string::npos, widths);
+        }
+        for (size_t s = 0; s < slots.size(); ++s) slots[s].width = widths[s];
+        out.issue = cf.issue;
+        out.ops.reserve(cf.ops.size() + slots.size());
+        size_t s = 0;
+        for (size_t k = 0; k < cf.ops.size(); ++k) {
+            if (s < slots.size() && slots[s].op == k) {
+                if (slots[s].measured && slots[s].width > 0) {
+                    CompiledOp width;
+                    width.kind = CompiledOp::Directive;
+                    width.directive = CompiledOp::Width;
+                    width.value = static_cast<int>(std::min<size_t>(slots[s].width, INT_MAX));
+                    out.ops.push_back(std::move(width));
+                }
+                ++s;
+            }
+            out.ops.push_back(cf.ops[k]);
+        }
+        return true;
+    }
+
+    // Returns how many arguments the format consumed; stops at the first problem, which goes to issue
+    static size_t runCompiled(const CompiledFormat &cf, const Registry &reg, ArgList argsVec, Sink &output, FormatIssue &issue) {
+        FormatState fs;
+        size_t argIndex = 0;
+        std::string lateJoin; // fs.join set by a LateDirective points here
+        for (const CompiledOp &op : cf.ops) {
+            switch (op.kind) {
+                case CompiledOp::Literal:
+                    output.write(op.text);
+                    if (op.resetsWidth && fs.widthTemp) { fs.width = 0; fs.widthTemp = false; }
+                    break;
+                case CompiledOp::Arg:
+                    if (argIndex < argsVec.size) formatArgWithModifiers(argsVec.data[argIndex++], fs, output);
+                    else output.write("{}");
+                    break;
+                case CompiledOp::Func:
+                    if (argIndex >= argsVec.size) {
+                        issue = FormatIssue{"Not enough arguments for function format '{" + op.text + "}'", op.offset, "{" + op.text + "}", FormatIssue::Arguments};
+                        return argIndex;
+                    }
+                    {
+                        VariantType arg = argsVec.data[argIndex++].toVariant();
+                        if (op.accepts && !op.accepts(arg)) {
+                            issue = FormatIssue{"Type mismatch for funcAdapter '" + op.text + "' (at byte " + std::to_string(op.offset) + ")",
+                                                op.offset, "{" + op.text + "}", FormatIssue::Type};
+                            return argIndex;
+                        }
+                        // padded like an argument, so colored funcAdapter output lines up too
+                        writePadded(op.func(arg), fs, output);
+                    }
+                    if (fs.widthTemp) { fs.width = 0; fs.widthTemp = false; }
+                    break;
+                case CompiledOp::Directive:
+                    applyDirective(op, fs);
+                    break;
+                case CompiledOp::LateDirective: {
+                    std::string token;
+                    if (!processInnerInToken(op.text, reg, argsVec, argIndex, token, issue)) {
+                        issue.offset = op.offset;
+                        issue.token = "[[" + op.text + "]]";
+                        return argIndex;
+                    }
+                    CompiledOp resolved = parseDirective(token);
+                    if (resolved.kind == CompiledOp::Error) {
+                        issue = FormatIssue{resolved.text + " (at byte " + std::to_string(op.offset) + ")", op.offset, "[[" + op.text + "]]", FormatIssue::Directive};
+                        return argIndex;
+                    }
+                    if (resolved.kind == CompiledOp::Literal) {
+                        output.write(resolved.text);
+                    } else if (resolved.directive == CompiledOp::Join) {
+                        lateJoin = std::move(resolved.text);
+                        fs.join = lateJoin;
+                    } else {
+                        applyDirective(resolved, fs);
+                    }
+                    break;
+                }
+                case CompiledOp::Error:
+                    issue = cf.issue;
+                    return argIndex;
+            }
+        }
+        return argIndex;
+    }
+
+    // Expands {}, {FORMAT} and (LABEL) inside a [[...]] token into innerWork. On failure the
+    // message and code are set in issue, the caller knows where the token is.
+    static bool processInnerInToken(const std::string &tokenSrc, const Registry &reg, ArgList argsVec, size_t &argIndex,
+                                    std::string &innerWork, FormatIssue &issue) {
+        auto fail = [&](std::string message, FormatIssue::Code code) {
+            issue.message = std::move(message);
+            issue.code = code;
+            return false;
+        };
+        auto tooDeep = [&] {
+            return fail("Adapter expansion nested deeper than " + std::to_string(ExpansionStack::maxDepth) +
+                        " levels inside [[]] token: [[" + tokenSrc + "]]", FormatIssue::Adapter);
+        };
+        innerWork.clear();
+        ExpansionStack in(tokenSrc);
+        std::string scratch;
+        while (!in.done()) {
+            char ch = in.peek();
+            if ((ch == '{' || ch == '(') && in.is(1, ch)) {
+                innerWork += ch;
+                in.skip(2);
+                continue;
+            }
+            if (ch == '{') {
+                size_t kk = in.find('}', 0);
+                if (kk == std::string::npos) {
+                    return fail("Unclosed '{' inside [[]] token: [[" + tokenSrc + "]]", FormatIssue::Brackets);
+                }
+                std::string_view inner = in.text(1, kk, scratch);
+                if (inner.empty()) {
+                    if (argIndex >= argsVec.size) {
+                        return fail("Not enough arguments for {} inside [[]] token: [[" + tokenSrc + "]]", FormatIssue::Arguments);
+                    }
+                    if (!in.expandOwned(kk + 1, argsVec.data[argIndex].text())) return tooDeep();
+                    ++argIndex;
+                    continue;
+                } else {
+                    if (inner.find('[') != std::string::npos || inner.find('(') != std::string::npos) {
+                        innerWork += in.text(0, kk + 1, scratch);
+                        in.skip(kk + 1);
+                        continue;
+                    }
+                    AdapterEntry e = reg.lookup(inner, AdapterEntry::Format);
+                    if (e.format) {
+                        if (!in.expand(kk + 1, *e.format)) return tooDeep();
+                        continue;
+                    } else {
+                        return fail("Unknown format adapter '{" + std::string(inner) + "}' inside [[]] token: [[" + tokenSrc + "]]", FormatIssue::Adapter);
+                    }
+                }
+            }
+            if (ch == '(') {
+                size_t kk = in.find(')', 0);
+                if (kk == std::string::npos) {
+                    return fail("Unclosed '(' inside [[]] token: [[" + tokenSrc + "]]", FormatIssue::Brackets);
+                }
+                std::string_view name = in.text(1, kk, scratch);
+                AdapterEntry e = reg.lookup(name, AdapterEntry::Label);
+                if (e.label) {
+                    if (!in.expand(kk + 1, *e.label)) return tooDeep();
+                    continue;
+                } else {
+                    return fail("Unknown label '(" + std::string(name) + ")' inside [[]] token: [[" + tokenSrc + "]]", FormatIssue::Adapter);
+                }
+            }
+            std::string_view run = in.run();
+            size_t j = std::min(run.find_first_of("{(", 1), run.size());
+            innerWork += run.substr(0, j);
+            in.skip(j);
+        }
+        return true;
+    }
+
+    // Compile-time scan of AFS_FMT literals. Mirrors compileFormat for everything that does
+    // not depend on the adapter registry; (LABEL) / {NAME} only mark the format as dynamic.
+    enum class StaticFormatError : unsigned char {
+        None, Parentheses, CurlyBraces, SquareBrackets,
+        UnclosedDirective, EmptyDirective, UnknownDirective, DirectiveValue
+    };
+    struct StaticToken {
+        enum Kind : unsigned char { Literal, Arg, Directive, Endl, Late };
+        Kind kind = Literal;
+        CompiledOp::DirectiveKind directive = CompiledOp::Left;
+        bool resetsWidth = false;
+        int value = 0;
+        size_t begin = 0, end = 0; // literal text / late token source / JOIN separator
+    };
+    template <size_t N>
+    struct StaticFormatScan {
+        StaticToken tokens[N == 0 ? 1 : N] = {};
+        size_t count = 0;
+        size_t slots = 0;      // {} placeholders, including the ones inside [[...]]
+        bool dynamic = false;  // uses (LABEL) / {NAME}, compiled against the registry at runtime
+        StaticFormatError error = StaticFormatError::None;
+    };
+
+    static constexpr StaticFormatError staticBracketError(std::string_view s) {
+        int paren = 0, curly = 0, square = 0;
+        for (size_t i = 0; i < s.size(); ++i) {
+            char c = s[i];
+            bool doubled = i + 1 < s.size() && s[i + 1] == c;
+            if (c == '(' || c == '{') {
+                if (doubled) { ++i; continue; }
+                ++(c == '(' ? paren : curly);
+            } else if (c == ')' || c == '}') {
+                if (doubled) { ++i; continue; }
+                int &depth = c == ')' ? paren : curly;
+                if (depth > 0) --depth;
+            } else if (c == '[') {
+                if (i > 0 && s[i - 1] == '\033') continue;
+                if (doubled) { ++square; ++i; }
+            } else if (c == ']' && doubled) {
+                if (square == 0) return StaticFormatError::SquareBrackets;
+                --square;
+                ++i;
+            }
+        }
+        if (paren) return StaticFormatError::Parentheses;
+        if (curly) return StaticFormatError::CurlyBraces;
+        if (square) return StaticFormatError::SquareBrackets;
+        return StaticFormatError::None;
+    }
+
+    // std::stoi semantics: leading blanks, optional sign, digits, trailing garbage ignored
+    static constexpr bool parseStaticInt(std::string_view v, int &out) {
+        size_t i = 0;
+        while (i < v.size() && (v[i] == ' ' || (v[i] >= '\t' && v[i] <= '\r'))) ++i;
+        bool neg = false;
+        if (i < v.size() && (v[i] == '+' || v[i] == '-')) { neg = v[i] == '-'; ++i; }
+        if (i >= v.size() || v[i] < '0' || v[i] > '9') return false;
+        long long acc = 0;
+        for (; i < v.size() && v[i] >= '0' && v[i] <= '9'; ++i) {
+            acc = acc * 10 + (v[i] - '0');
+            if (acc > 2147483648LL) return false;
+        }
+        if (!neg && acc > 2147483647LL) return false;
+        out = static_cast<int>(neg ? -acc : acc);
+        return true;
+    }
+
+    static constexpr StaticFormatError parseStaticDirective(std::string_view token, StaticToken &t) {
+        t.kind = StaticToken::Directive;
+        if (token == "LEFT") t.directive = CompiledOp::Left;
+        else if (token == "RIGHT") t.directive = CompiledOp::Right;
+        else if (token == "RESET") t.directive = CompiledOp::Reset;
+        else if (token == "FIXED") t.directive = CompiledOp::Fixed;
+        else if (token == "SCIENTIFIC") t.directive = CompiledOp::Scientific;
+        else if (token == "ENDL") t.kind = StaticToken::Endl;
+        else {
+            size_t pos = token.find(':');
+            if (pos == std::string_view::npos) return StaticFormatError::UnknownDirective;
+            std::string_view key = token.substr(0, pos), val = token.substr(pos + 1);
+            if (key == "SETW" || key == "PREC") {
+                t.directive = key == "SETW" ? CompiledOp::Width : CompiledOp::Precision;
+                if (!parseStaticInt(val, t.value)) return StaticFormatError::DirectiveValue;
+            } else if (key == "FILL") {
+                t.directive = CompiledOp::Fill;
+                if (val.empty()) return StaticFormatError::DirectiveValue;
+                t.value = val[0];
+            } else if (key == "JOIN") {
+                // separator position within the token, the caller makes it absolute
+                t.directive = CompiledOp::Join;
+                t.begin = pos + 1;
+                t.end = token.size();
+            } else {
+                return StaticFormatError::UnknownDirective;
+            }
+        }
+        return StaticFormatError::None;
+    }
+
+    template <size_t N>
+    static constexpr StaticFormatScan<N> scanStaticFormat(std::string_view s) {
+        StaticFormatScan<N> r{};
+        r.error = staticBracketError(s);
+        if (r.error != StaticFormatError::None) return r;
+        auto literal = [&r](size_t b, size_t e, bool resets) {
+            if (r.count && r.tokens[r.count - 1].kind == StaticToken::Literal && r.tokens[r.count - 1].end == b) {
+                r.tokens[r.count - 1].end = e;
+                r.tokens[r.count - 1].resetsWidth = r.tokens[r.count - 1].resetsWidth || resets;
+                return;
+            }
+            StaticToken t;
+            t.begin = b;
+            t.end = e;
+            t.resetsWidth = resets;
+            r.tokens[r.count++] = t;
+        };
+        for (size_t i = 0; i < s.size(); ) {
+            char c = s[i];
+            if ((c == '{' || c == '(') && i + 1 < s.size() && s[i + 1] == c) {
+                literal(i, i + 1, false);
+                i += 2;
+                continue;
+            }
+            if (c == '[' && i + 1 < s.size() && s[i + 1] == '[') {
+                size_t j = s.find("]]", i + 2);
+                if (j == std::string_view::npos) {
+                    bool looksLikeCSI = false;
+                    for (size_t k = i + 1; k < s.size() && k < i + 20; ++k) {
+                        if ((s[k] >= 'A' && s[k] <= 'Z') || (s[k] >= 'a' && s[k] <= 'z')) { looksLikeCSI = true; break; }
+                    }
+                    if (!looksLikeCSI) { r.error = StaticFormatError::UnclosedDirective; return r; }
+                    literal(i, i + 1, false);
+                    ++i;
+                    continue;
+                }
+                std::string_view token = s.substr(i + 2, j - (i + 2));
+                if (token.empty()) { r.error = StaticFormatError::EmptyDirective; return r; }
+                StaticToken t;
+                if (token.find_first_of("{(") != std::string_view::npos) {
+                    // same walk as processInnerInToken: count {} and spot adapter references
+                    for (size_t k = 0; k < token.size(); ) {
+                        char ch = token[k];
+                        if ((ch == '{' || ch == '(') && k + 1 < token.size() && token[k + 1] == ch) { k += 2; continue; }
+                        if (ch == '{' || ch == '(') {
+                            size_t kk = token.find(ch == '{' ? '}' : ')', k);
+                            if (kk == std::string_view::npos) { r.error = StaticFormatError::DirectiveValue; return r; }
+                            std::string_view inner = token.substr(k + 1, kk - k - 1);
+                            if (ch == '{' && inner.empty()) ++r.slots;
+                            else if (ch == '(' || inner.find_first_of("[(") == std::string_view::npos) r.dynamic = true;
+                            k = kk + 1;
+                            continue;
+                        }
+                        ++k;
+                    }
+                    t.kind = StaticToken::Late;
+                    t.begin = i + 2;
+                    t.end = j;
+                } else {
+                    r.error = parseStaticDirective(token, t);
+                    if (r.error != StaticFormatError::None) return r;
+                    if (t.kind == StaticToken::Directive && t.directive == CompiledOp::Join) {
+                        t.begin += i + 2;
+                        t.end += i + 2;
+                    }
+                }
+                r.tokens[r.count++] = t;
+                i = j + 2;
+                continue;
+            }
+            if (c == '(' || c == '{') {
+                size_t j = s.find(c == '(' ? ')' : '}', i);
+                if (j == std::string_view::npos) {
+                    literal(i, i + 1, c == '{');
+                    ++i;
+                    continue;
+                }
+                if (c == '(') {
+                    // label lookup at runtime; when it is not one the inside is formatted as usual
+                    r.dynamic = true;
+                    literal(i, i + 1, false);
+                    ++i;
+                    continue;
+                }
+                std::string_view inner = s.substr(i + 1, j - i - 1);
+                if (inner.empty()) {
+                    StaticToken t;
+                    t.kind = StaticToken::Arg;
+                    r.tokens[r.count++] = t;
+                    ++r.slots;
+                } else if (inner.find_first_of("[(") != std::string_view::npos) {
+                    literal(i, j + 1, false);
+                } else {
+                    r.dynamic = true;
+                    literal(i, j + 1, false);
+                }
+                i = j + 1;
+                continue;
+            }
+            literal(i, i + 1, true);
+            ++i;
+        }
+        return r;
+    }
+
+    template <typename Fmt>
+    struct StaticFormat {
+        static constexpr std::string_view text = Fmt::value();
+        static constexpr StaticFormatScan<text.size()> scan = scanStaticFormat<text.size()>(text);
+    };
+
+    template <typename Fmt, size_t argCount>
+    static void checkStaticFormat() {
+        using SF = StaticFormat<Fmt>;
+        static_assert(SF::scan.error != StaticFormatError::Parentheses, "AFS_FMT: mismatched parentheses in format string");
+        static_assert(SF::scan.error != StaticFormatError::CurlyBraces, "AFS_FMT: mismatched curly braces in format string");
+        static_assert(SF::scan.error != StaticFormatError::SquareBrackets, "AFS_FMT: mismatched square brackets in format string");
+        static_assert(SF::scan.error != StaticFormatError::UnclosedDirective, "AFS_FMT: unclosed '[[' in format string");
+        static_assert(SF::scan.error != StaticFormatError::EmptyDirective, "AFS_FMT: empty [[]] directive is not allowed");
+        static_assert(SF::scan.error != StaticFormatError::UnknownDirective, "AFS_FMT: unknown [[]] directive");
+        static_assert(SF::scan.error != StaticFormatError::DirectiveValue, "AFS_FMT: invalid value in [[]] directive");
+        static_assert(argCount >= SF::scan.slots, "AFS_FMT: not enough arguments for the {} placeholders");
+        static_assert(SF::scan.dynamic || argCount <= SF::scan.slots, "AFS_FMT: more arguments than {} placeholders");
+    }
+
+    template <typename SF>
+    static CompiledFormat buildStaticFormat() {
+        CompiledFormat built, *cf = &built;
+        for (size_t n = 0; n < SF::scan.count; ++n) {
+            const StaticToken &t = SF::scan.tokens[n];
+            CompiledOp op;
+            switch (t.kind) {
+                case StaticToken::Literal:
+                    cf->append(std::string(SF::text.substr(t.begin, t.end - t.begin)), t.resetsWidth);
+                    break;
+                case StaticToken::Arg:
+                    op.kind = CompiledOp::Arg;
+                    cf->push(std::move(op));
+                    break;
+                case StaticToken::Directive:
+                    op.kind = CompiledOp::Directive;
+                    op.directive = t.directive;
+                    op.value = t.value;
+                    op.text = std::string(SF::text.substr(t.begin, t.end - t.begin));
+                    cf->push(std::move(op));
+                    break;
+                case StaticToken::Endl:
+                    cf->append('\n', false);
+                    break;
+                case StaticToken::Late:
+                    op.kind = CompiledOp::LateDirective;
+                    op.offset = t.begin - 2;
+                    op.text = std::string(SF::text.substr(t.begin, t.end - t.begin));
+                    cf->push(std::move(op));
+                    break;
+            }
+        }
+        return built;
+    }
+
+    struct StaticFormatSlot {
+        uint64_t generation = 0;
+        std::shared_ptr<const CompiledFormat> cf;
+    };
+    // Registry independent formats are built once from the compile-time tokens;
+    // everything else is compiled at runtime once per registry generation.
+    template <typename Fmt>
+    static std::shared_ptr<const CompiledFormat> staticCompiledFormat(const SnapshotScope &scope) {
+        using SF = StaticFormat<Fmt>;
+        if constexpr (!SF::scan.dynamic) {
+            // shared by all threads; the returned pointer does not own it, so no refcount traffic
+            static const CompiledFormat cf = buildStaticFormat<SF>();
+            return std::shared_ptr<const CompiledFormat>(std::shared_ptr<const CompiledFormat>(), &cf);
+        } else {
+            thread_local StaticFormatSlot slot;
+            if (slot.generation != scope.generation()) {
+                slot.cf = compileFormat(std::string(SF::text), scope.registry());
+                slot.generation = scope.generation();
+            }
+            return slot.cf;
+        }
+    }
+
+    template <typename T>
+    struct is_streamable {
+        template <typename U>
+        static auto test(int) -> decltype(std::declval<std::ostream&>() << std::declval<U>(), std::true_type());
+        template <typename>
+        static auto test(...) -> std::false_type;
+        static constexpr bool value = decltype(test<T>(0))::value;
+    };
+    template <typename T>
+    struct hasFormatter {
+        template <typename U>
+        static auto test(int) -> decltype(std::declval<const AsulFormatter<U>&>().format(std::declval<const U&>(), std::declval<Sink&>()), std::true_type());
+        template <typename>
+        static auto test(...) -> std::false_type;
+        static constexpr bool value = decltype(test<T>(0))::value;
+    };
+    template <typename T>
+    static const FormatArg::CustomOps &customOps() {
+        static const FormatArg::CustomOps ops = {
+            [](const void *p, Sink &out) { AsulFormatter<T>().format(*static_cast<const T*>(p), out); },
+            [](const void *p, VariantType &out) {
+                if constexpr (std::is_copy_constructible_v<T>) {
+                    // funcAdapters see it as before, so installTypedFuncAdapter<T> still works
+                    out = std::any(*static_cast<const T*>(p));
+                } else {
+                    std::string s;
+                    StringSink sink(s);
+                    AsulFormatter<T>().format(*static_cast<const T*>(p), sink);
+                    out = std::move(s);
+                }
+            }};
+        return ops;
+    }
+
+    // Anything std::begin / std::end can walk: containers, arrays, spans, ranges of pairs (maps)
+    template <typename T>
+    struct isRange {
+        template <typename U>
+        static auto test(int) -> decltype(std::begin(std::declval<const U&>()) != std::end(std::declval<const U&>()),
+                                          *std::begin(std::declval<const U&>()), std::true_type());
+        template <typename>
+        static auto test(...) -> std::false_type;
+        static constexpr bool value = decltype(test<T>(0))::value;
     };
-    std::string formatVariantWithModifiers(const VariantType& v, FormatState &fs) {
-        std::ostringstream oss;
+    template <typename T>
+    struct isPair : std::false_type {};
+    template <typename A, typename B>
+    struct isPair<std::pair<A, B> > : std::true_type {};
+    template <typename T>
+    static const FormatArg::RangeOps &rangeOps() {
+        static const FormatArg::RangeOps ops = {
+            [](const void *p, FormatState &fs, Sink &out) { writeRange(*static_cast<const T*>(p), fs, out); },
+            [](const void *p, VariantType &out) {
+                if constexpr (std::is_copy_constructible_v<T>) {
+                    // installTypedFuncAdapter<std::vector<int> > still gets the container
+                    out = std::any(*static_cast<const T*>(p));
+                } else {
+                    std::string s;
+                    StringSink sink(s);
+                    FormatState fs;
+                    writeRange(*static_cast<const T*>(p), fs, sink);
+                    out = std::move(s);
+                }
+            }};
+        return ops;
+    }
+
+    // Integers other than int / bool / the char types, formatted as 64 bit
+    template <typename T>
+    static constexpr bool isWideInt() {
+        return std::is_same_v<T, short> || std::is_same_v<T, unsigned short> || std::is_same_v<T, unsigned> ||
+               std::is_same_v<T, long> || std::is_same_v<T, unsigned long> ||
+               std::is_same_v<T, long long> || std::is_same_v<T, unsigned long long>;
+    }
+    // Printed as an address like an ostream does; char pointers are strings and function
+    // pointers are left to operator<<
+    template <typename T>
+    static constexpr bool isObjectPointer() {
+        if constexpr (std::is_pointer_v<T>) {
+            using P = std::remove_cv_t<std::remove_pointer_t<T> >;
+            return !std::is_function_v<P> && !std::is_same_v<P, char> && !std::is_same_v<P, signed char> && !std::is_same_v<P, unsigned char>;
+        } else {
+            return false;
+        }
+    }
+
+    template <typename T>
+    static FormatArg makeArg(const T& value) {
+        using DT = std::decay_t<T>;
+        FormatArg a;
+        if constexpr (std::is_same_v<DT, int>) { a.kind = FormatArg::Int; a.i = value; }
+        else if constexpr (std::is_same_v<DT, double>) { a.kind = FormatArg::Double; a.d = value; }
+        else if constexpr (std::is_same_v<DT, bool>) { a.kind = FormatArg::Bool; a.b = value; }
+        else if constexpr (std::is_same_v<DT, char>) { a.kind = FormatArg::Char; a.c = value; }
+        else if constexpr (std::is_same_v<DT, std::string> || std::is_same_v<DT, std::string_view>) { a.kind = FormatArg::String; a.str = {value.data(), value.size()}; }
+        else if constexpr (std::is_same_v<DT, float>) { a.kind = FormatArg::Double; a.d = value; } // as an ostream prints it
+        else if constexpr (std::is_same_v<DT, long double>) { a.kind = FormatArg::LongDouble; a.ld = &value; }
+        else if constexpr (std::is_same_v<DT, signed char> || std::is_same_v<DT, unsigned char>) { a.kind = FormatArg::Char; a.c = static_cast<char>(value); }
+        else if constexpr (isWideInt<DT>()) {
+            if constexpr (std::is_signed_v<DT>) { a.kind = FormatArg::Int64; a.ll = value; }
+            else { a.kind = FormatArg::UInt64; a.ull = value; }
+        }
+        else if constexpr (std::is_same_v<DT, std::nullptr_t>) { a.kind = FormatArg::String; a.str = {"nullptr", 7}; } // as an ostream prints it
+        else if constexpr (std::is_same_v<DT, const char*> || std::is_same_v<DT, char*>) {
+            const char *p = value;
+            a.kind = FormatArg::String;
+            a.str = {p ? p : "", p ? std::strlen(p) : 0};
+        }
+        else if constexpr (std::is_array_v<T>) { a.kind = FormatArg::Range; a.range = {&value, &rangeOps<T>()}; }
+        else if constexpr (std::is_same_v<DT, std::any>) { a.kind = FormatArg::Any; a.any = &value; }
+        else if constexpr (isObjectPointer<DT>()) { a.kind = FormatArg::Pointer; a.ptr = static_cast<const void*>(value); }
+        else if constexpr (hasFormatter<DT>::value) { a.kind = FormatArg::Custom; a.custom = {&value, &customOps<DT>()}; }
+        else if constexpr (is_streamable<T>::value) {
+            // streamed only if the argument is actually formatted
+            a.kind = FormatArg::Object;
+            a.obj = {&value, [](const void *p, VariantType &out) {
+                std::ostringstream oss;
+                oss << *static_cast<const T*>(p);
+                out = oss.str();
+            }};
+        }
+        else if constexpr (isRange<DT>::value) { a.kind = FormatArg::Range; a.range = {&value, &rangeOps<DT>()}; }
+        else {
+            // unknown/non-streamable custom type: handed out as std::any so installTypedFuncAdapter can any_cast it
+            a.kind = FormatArg::Object;
+            a.obj = {&value, [](const void *p, VariantType &out) { out = std::any(*static_cast<const T*>(p)); }};
+        }
+        return a;
+    }
+
+    static void applyModifiers(std::ostream &oss, const FormatState &fs) {
         if (fs.fillChar != ' ') oss << std::setfill(fs.fillChar);
         if (fs.precision >= 0) oss << std::setprecision(fs.precision);
         if (fs.fixedFmt) oss << std::fixed;
@@ -695,16 +3038,211 @@ private:
         if (fs.left) oss << std::left;
         if (fs.right) oss << std::right;
         if (fs.width > 0) oss << std::setw(fs.width);
+    }
 
-        if (std::holds_alternative<int>(v)) oss << std::get<int>(v);
-        else if (std::holds_alternative<double>(v)) oss << std::get<double>(v);
-        else if (std::holds_alternative<std::string>(v)) oss << std::get<std::string>(v);
-        else if (std::holds_alternative<bool>(v)) oss << (std::get<bool>(v) ? "true" : "false");
-        else if (std::holds_alternative<char>(v)) oss << std::get<char>(v);
+    static void writeFill(Sink &out, char fill, size_t n) {
+        char chunk[64];
+        std::memset(chunk, fill, std::min(n, sizeof chunk));
+        for (; n > sizeof chunk; n -= sizeof chunk) out.write(chunk, sizeof chunk);
+        out.write(chunk, n);
+    }
+
+    // Width, fill and alignment as std::setw / std::setfill / std::left would apply them, with
+    // the width counted in terminal columns (DisplayWidth) instead of bytes
+    static void writePadded(std::string_view text, FormatState &fs, Sink &out) {
+        size_t width = fs.width > 0 ? static_cast<size_t>(fs.width) : 0;
+        // counted only when there is a width to pad to; plain ASCII takes the SSE2 run
+        size_t columns = width == 0 ? 0 : DisplayWidth::of(text);
+        if (columns >= width) {
+            out.write(text);
+        } else if (fs.left) {
+            out.write(text);
+            writeFill(out, fs.fillChar, width - columns);
+        } else {
+            writeFill(out, fs.fillChar, width - columns);
+            out.write(text);
+        }
+        if (fs.widthTemp) { fs.width = 0; fs.widthTemp = false; }
+    }
+
+    // Numbers go through std::to_chars with the printf conversion an ostream would pick
+    // (%g / %f / %e, precision 6 unless PREC is set). Falls back to a stream only when the
+    // stack buffer is too small for an extreme PREC.
+    template <typename F>
+    static void writeFloat(F v, FormatState &fs, Sink &out) {
+        char buf[128];
+        std::chars_format cf = fs.fixedFmt ? std::chars_format::fixed
+                             : fs.scientificFmt ? std::chars_format::scientific
+                             : std::chars_format::general;
+        std::to_chars_result r = std::to_chars(buf, buf + sizeof buf, v, cf, fs.precision >= 0 ? fs.precision : 6);
+        if (r.ec != std::errc()) {
+            std::ostringstream oss;
+            applyModifiers(oss, fs);
+            oss << v;
+            if (fs.widthTemp) { fs.width = 0; fs.widthTemp = false; }
+            out.write(oss.str());
+            return;
+        }
+        writePadded(std::string_view(buf, static_cast<size_t>(r.ptr - buf)), fs, out);
+    }
+    static void formatArgWithModifiers(const FormatArg &a, FormatState &fs, Sink &out) {
+        char buf[128];
+        std::to_chars_result r{buf, std::errc()};
+        switch (a.kind) {
+            case FormatArg::Int:
+                r = std::to_chars(buf, buf + sizeof buf, a.i);
+                break;
+            case FormatArg::Int64:
+                r = std::to_chars(buf, buf + sizeof buf, a.ll);
+                break;
+            case FormatArg::UInt64:
+                r = std::to_chars(buf, buf + sizeof buf, a.ull);
+                break;
+            case FormatArg::Pointer:
+                // 0x prefixed hex as an ostream prints it, a null pointer as 0
+                buf[0] = '0';
+                if (!a.ptr) {
+                    r.ptr = buf + 1;
+                    break;
+                }
+                buf[1] = 'x';
+                r = std::to_chars(buf + 2, buf + sizeof buf, reinterpret_cast<uintptr_t>(a.ptr), 16);
+                break;
+            case FormatArg::Double:
+                writeFloat(a.d, fs, out);
+                return;
+            case FormatArg::LongDouble:
+                writeFloat(*a.ld, fs, out);
+                return;
+            case FormatArg::String:
+                writePadded(std::string_view(a.str.data, a.str.size), fs, out);
+                return;
+            case FormatArg::Bool:
+                writePadded(a.b ? "true" : "false", fs, out);
+                return;
+            case FormatArg::Char:
+                writePadded(std::string_view(&a.c, 1), fs, out);
+                return;
+            case FormatArg::Custom:
+                if (fs.width > 0) {
+                    std::string text;
+                    StringSink sink(text);
+                    a.custom.ops->write(a.custom.ptr, sink);
+                    writePadded(text, fs, out);
+                } else {
+                    a.custom.ops->write(a.custom.ptr, out);
+                }
+                return;
+            case FormatArg::Range:
+                a.range.ops->write(a.range.ptr, fs, out);
+                return;
+            case FormatArg::Any:
+            case FormatArg::Object: {
+                VariantType v = a.toVariant();
+                if (const std::string *str = std::get_if<std::string>(&v)) writePadded(*str, fs, out);
+                else writePadded(variantToString(v), fs, out);
+                return;
+            }
+        }
+        writePadded(std::string_view(buf, static_cast<size_t>(r.ptr - buf)), fs, out);
+    }
 
+    // Elements joined by fs.join, each formatted with the current state: SETW / PREC / FILL
+    // apply to every element and a temporary SETW ends after the whole range. Map entries
+    // print as key: value, nested ranges inside [].
+    template <typename R>
+    static void writeRange(const R &r, FormatState &fs, Sink &out) {
+        FormatState each = fs;
+        each.widthTemp = false;
+        using E = std::decay_t<decltype(*std::begin(r))>;
+        if constexpr (isBatchNumber<E>()) {
+            writeNumbers(std::begin(r), std::end(r), each, out);
+        } else {
+            bool first = true;
+            for (const auto &e : r) {
+                if (!first) out.write(each.join);
+                first = false;
+                writeElement(e, each, out);
+            }
+        }
         if (fs.widthTemp) { fs.width = 0; fs.widthTemp = false; }
+    }
+    template <typename E>
+    static void writeElement(const E &e, FormatState &fs, Sink &out) {
+        if constexpr (isPair<E>::value) {
+            writeElement(e.first, fs, out);
+            out.write(": ");
+            writeElement(e.second, fs, out);
+        } else {
+            FormatArg a = makeArg(e);
+            if (a.kind == FormatArg::Range) out.write("[");
+            formatArgWithModifiers(a, fs, out);
+            if (a.kind == FormatArg::Range) out.write("]");
+        }
+    }
 
-        return oss.str();
+    // Element types whose ranges go through writeNumbers
+    template <typename E>
+    static constexpr bool isBatchNumber() {
+        return std::is_same_v<E, int> || isWideInt<E>() || std::is_same_v<E, float> || std::is_same_v<E, double>;
+    }
+    // Numeric ranges: digits, padding and separators are converted straight into a stack
+    // buffer that goes to the sink in chunks, one write per few KiB instead of two per
+    // element. Same text as writeElement; an element that does not fit (extreme PREC) or a
+    // huge SETW / separator takes the per element path.
+    template <typename It>
+    static void writeNumbers(It it, It last, FormatState &fs, Sink &out) {
+        char buf[4096];
+        size_t n = 0;
+        const std::string_view sep = fs.join;
+        const size_t width = fs.width > 0 ? static_cast<size_t>(fs.width) : 0;
+        const size_t reserve = sep.size() + width + 64; // separator, padding and any integer
+        std::chars_format cf = fs.fixedFmt ? std::chars_format::fixed
+                             : fs.scientificFmt ? std::chars_format::scientific
+                             : std::chars_format::general;
+        int precision = fs.precision >= 0 ? fs.precision : 6;
+        for (bool first = true; it != last; ++it, first = false) {
+            if (sizeof buf - n < reserve) {
+                out.write(buf, n);
+                n = 0;
+            }
+            if (sizeof buf < reserve) {
+                if (!first) out.write(sep);
+                writeElement(*it, fs, out);
+                continue;
+            }
+            if (!first) {
+                if (sep.size() == 1) buf[n] = sep[0];
+                else std::memcpy(buf + n, sep.data(), sep.size());
+                n += sep.size();
+            }
+            char *p = buf + n;
+            std::to_chars_result r;
+            auto v = *it;
+            if constexpr (std::is_floating_point_v<decltype(v)>) {
+                r = std::to_chars(p, buf + sizeof buf - width, static_cast<double>(v), cf, precision);
+            } else {
+                r = std::to_chars(p, buf + sizeof buf - width, v);
+            }
+            if (r.ec != std::errc()) {
+                out.write(buf, n);
+                n = 0;
+                writeElement(v, fs, out);
+                continue;
+            }
+            size_t len = static_cast<size_t>(r.ptr - p);
+            if (len < width) {
+                if (fs.left) {
+                    std::memset(r.ptr, fs.fillChar, width - len);
+                } else {
+                    std::memmove(p + (width - len), p, len);
+                    std::memset(p, fs.fillChar, width - len);
+                }
+                len = width;
+            }
+            n += len;
+        }
+        out.write(buf, n);
     }
 };
 
@@ -714,15 +3252,90 @@ inline AsulFormatString &asul_formatter() {
 }
 
 template <typename... Args>
-inline std::string f(const std::string &fmt, const Args &...args) {
+inline std::string f(std::string_view fmt, const Args &...args) {
     return asul_formatter().template f<Args...>(fmt, args...);
 }
 
-inline void print(const std::string &fmt) { asul_formatter().print(fmt); }
+inline void print(std::string_view fmt) { asul_formatter().print(fmt); }
 template <typename... Args>
-inline void print(const std::string &fmt, const Args &...args) {
+inline void print(std::string_view fmt, const Args &...args) {
+    asul_formatter().print(fmt, args...);
+}
+template <typename... Args>
+inline void print(AsulFormatString::Sink &sink, std::string_view fmt, const Args &...args) {
+    asul_formatter().print(sink, fmt, args...);
+}
+
+template <typename OutputIt, typename Fmt, typename... Args>
+inline OutputIt f_to(OutputIt out, const Fmt &fmt, const Args &...args) {
+    return asul_formatter().f_to(out, fmt, args...);
+}
+template <typename Fmt, typename... Args>
+inline AsulFormatString::FormatToNResult f_to_n(char *buf, size_t n, const Fmt &fmt, const Args &...args) {
+    return asul_formatter().f_to_n(buf, n, fmt, args...);
+}
+template <typename Fmt, typename... Args>
+inline std::string &f_append(std::string &out, const Fmt &fmt, const Args &...args) {
+    return asul_formatter().f_append(out, fmt, args...);
+}
+template <typename Fmt, typename... Args, typename = std::enable_if_t<!std::is_base_of_v<AsulFormatString::Sink, Fmt> > >
+inline AsulFormatString::FormatResult try_f(const Fmt &fmt, const Args &...args) {
+    return asul_formatter().try_f(fmt, args...);
+}
+template <typename Fmt, typename... Args, typename = std::enable_if_t<!std::is_base_of_v<AsulFormatString::Sink, Fmt> > >
+inline AsulFormatString::FormatIssue try_print(const Fmt &fmt, const Args &...args) {
+    return asul_formatter().try_print(fmt, args...);
+}
+template <typename Fmt, typename... Args>
+inline AsulFormatString::FormatIssue try_print(AsulFormatString::Sink &sink, const Fmt &fmt, const Args &...args) {
+    return asul_formatter().try_print(sink, fmt, args...);
+}
+template <typename Rows>
+inline std::string f_rows(std::string_view rowFmt, const Rows &rows, AsulFormatString::TableOptions options = AsulFormatString::TableOptions()) {
+    return asul_formatter().f_rows(rowFmt, rows, options);
+}
+template <typename Rows>
+inline void print_rows(std::string_view rowFmt, const Rows &rows, AsulFormatString::TableOptions options = AsulFormatString::TableOptions()) {
+    asul_formatter().print_rows(rowFmt, rows, options);
+}
+template <typename Rows>
+inline void print_rows(AsulFormatString::Sink &sink, std::string_view rowFmt, const Rows &rows,
+                       AsulFormatString::TableOptions options = AsulFormatString::TableOptions()) {
+    asul_formatter().print_rows(sink, rowFmt, rows, options);
+}
+template <typename Rows>
+inline AsulFormatString::FormatIssue try_print_rows(std::string_view rowFmt, const Rows &rows,
+                                                    AsulFormatString::TableOptions options = AsulFormatString::TableOptions()) {
+    return asul_formatter().try_print_rows(rowFmt, rows, options);
+}
+template <typename Rows>
+inline AsulFormatString::FormatIssue try_print_rows(AsulFormatString::Sink &sink, std::string_view rowFmt, const Rows &rows,
+                                                    AsulFormatString::TableOptions options = AsulFormatString::TableOptions()) {
+    return asul_formatter().try_print_rows(sink, rowFmt, rows, options);
+}
+
+// Format literal checked and tokenized at compile time:
+//   print(AFS_FMT("(INFO) [[SETW:20]]{}[[ENDL]]"), value);
+// Bracket mismatches, bad [[...]] directives and a wrong argument count become compile errors.
+#define AFS_FMT(literal) ([] { \
+        struct AfsStaticFormat : AsulFormatString::StaticFormatTag { \
+            static constexpr std::string_view value() { return literal; } \
+        }; \
+        return AfsStaticFormat{}; \
+    }())
+
+template <typename Fmt, typename... Args, typename = std::enable_if_t<std::is_base_of_v<AsulFormatString::StaticFormatTag, Fmt> > >
+inline std::string f(Fmt fmt, const Args &...args) {
+    return asul_formatter().f(fmt, args...);
+}
+template <typename Fmt, typename... Args, typename = std::enable_if_t<std::is_base_of_v<AsulFormatString::StaticFormatTag, Fmt> > >
+inline void print(Fmt fmt, const Args &...args) {
     asul_formatter().print(fmt, args...);
 }
+template <typename Fmt, typename... Args, typename = std::enable_if_t<std::is_base_of_v<AsulFormatString::StaticFormatTag, Fmt> > >
+inline void print(AsulFormatString::Sink &sink, Fmt fmt, const Args &...args) {
+    asul_formatter().print(sink, fmt, args...);
+}
 
 #endif // ASULFORMATSTRING_H
     
\ No newline at end of file
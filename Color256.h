@@ -1,12 +1,19 @@
 #ifndef COLOR_256_H
 #define COLOR_256_H
 #include <string>
+#include <string_view>
 #include <algorithm>
-#include <sstream>
+#include <cstddef>
+#include <vector>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define COLOR_256_SSE2
+#endif
 class Color256{
     public:
-        Color256(unsigned int r, unsigned int g, unsigned int b): r(r), g(g), b(b) {};
-        static Color256 rgba(unsigned int r, unsigned int g, unsigned int b, unsigned int a){
+        constexpr Color256(unsigned int r, unsigned int g, unsigned int b): r(r), g(g), b(b) {};
+        static constexpr Color256 rgba(unsigned int r, unsigned int g, unsigned int b, unsigned int a){
+            (void)a;
             Color256 color(
                 std::clamp(r, 0u, 255u),
                 std::clamp(g, 0u, 255u),
@@ -14,35 +21,158 @@ class Color256{
             );
             return color;
         }
-        unsigned int getR() const{
+        constexpr unsigned int getR() const{
             return r;
         };
-        unsigned int getG() const{
+        constexpr unsigned int getG() const{
             return g;
         };
-        unsigned int getB() const{
+        constexpr unsigned int getB() const{
             return b;
         };
+        // Index in the 6x6x6 cube of the 256 color palette
+        constexpr unsigned char toIndex256() const{
+            return index256(channel(r), channel(g), channel(b));
+        };
+        static constexpr unsigned char index256(unsigned char r, unsigned char g, unsigned char b){
+            return static_cast<unsigned char>(16 + 36 * ((r * 6) >> 8) + 6 * ((g * 6) >> 8) + ((b * 6) >> 8));
+        };
         std::string toANSI256() const{
-            int r6 = (r * 6) / 256;
-            int g6 = (g * 6) / 256;
-            int b6 = (b * 6) / 256;
-            int color_index = 16 + 36 * r6 + 6 * g6 + b6;
-            std::ostringstream oss;
-            oss << "\033[38;5;" << color_index << "m";
-            return oss.str();
+            return std::string(ansi256(toIndex256()));
         };
         std::string toANSIBackground256() const{
-            int r6 = (r * 6) / 256;
-            int g6 = (g * 6) / 256;
-            int b6 = (b * 6) / 256;
-            int color_index = 16 + 36 * r6 + 6 * g6 + b6;
-            std::ostringstream oss;
-            oss << "\033[48;5;" << color_index << "m";
-            return oss.str();
+            return std::string(ansiBackground256(toIndex256()));
+        };
+        // Escapes straight from the precomputed tables, no allocation
+        std::string_view toANSI256View() const{
+            return ansi256(toIndex256());
+        };
+        std::string_view toANSIBackground256View() const{
+            return ansiBackground256(toIndex256());
+        };
+        static std::string_view ansi256(unsigned char index);
+        static std::string_view ansiBackground256(unsigned char index);
+
+        // 24-bit color: ESC[38;2;R;G;Bm / ESC[48;2;R;G;Bm
+        std::string toANSITrueColor() const{
+            std::string s;
+            appendTrueColor(s, '3', channel(r), channel(g), channel(b));
+            return s;
+        };
+        std::string toANSITrueColorBackground() const{
+            std::string s;
+            appendTrueColor(s, '4', channel(r), channel(g), channel(b));
+            return s;
+        };
+
+        // Palette indices for n RGB triples, 16 at a time with SSE2
+        static void index256Batch(const unsigned char *rs, const unsigned char *gs, const unsigned char *bs, unsigned char *out, size_t n){
+            size_t i = 0;
+#ifdef COLOR_256_SSE2
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i six = _mm_set1_epi16(6), thirtySix = _mm_set1_epi16(36), sixteen = _mm_set1_epi16(16);
+            auto level = [&](__m128i v) { return _mm_srli_epi16(_mm_mullo_epi16(v, six), 8); };
+            auto half = [&](__m128i r8, __m128i g8, __m128i b8) {
+                __m128i idx = _mm_add_epi16(sixteen, _mm_mullo_epi16(level(r8), thirtySix));
+                idx = _mm_add_epi16(idx, _mm_mullo_epi16(level(g8), six));
+                return _mm_add_epi16(idx, level(b8));
+            };
+            for (; i + 16 <= n; i += 16) {
+                __m128i rv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rs + i));
+                __m128i gv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(gs + i));
+                __m128i bv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bs + i));
+                __m128i lo = half(_mm_unpacklo_epi8(rv, zero), _mm_unpacklo_epi8(gv, zero), _mm_unpacklo_epi8(bv, zero));
+                __m128i hi = half(_mm_unpackhi_epi8(rv, zero), _mm_unpackhi_epi8(gv, zero), _mm_unpackhi_epi8(bv, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(lo, hi));
+            }
+#endif
+            for (; i < n; ++i) out[i] = index256(rs[i], gs[i], bs[i]);
+        };
+
+        // Colors every UTF-8 code point of text with colorAt(i), i being the code point
+        // index, and ends with a reset. An escape is only written where the color differs
+        // from the previous code point.
+        template <typename Fn>
+        static std::string gradient(std::string_view text, Fn &&colorAt, bool trueColor = false){
+            std::vector<size_t> starts;
+            starts.reserve(text.size());
+            for (size_t i = 0; i < text.size(); ++i) {
+                if ((static_cast<unsigned char>(text[i]) & 0xC0) != 0x80) starts.push_back(i);
+            }
+            size_t n = starts.size();
+            std::vector<unsigned char> channels(n * 4);
+            unsigned char *rs = channels.data(), *gs = rs + n, *bs = gs + n, *idx = bs + n;
+            for (size_t i = 0; i < n; ++i) {
+                Color256 c = colorAt(i);
+                rs[i] = channel(c.r);
+                gs[i] = channel(c.g);
+                bs[i] = channel(c.b);
+            }
+            if (!trueColor) index256Batch(rs, gs, bs, idx, n);
+
+            std::string out;
+            out.reserve(text.size() + n * 4 + 8);
+            for (size_t i = 0; i < n; ++i) {
+                bool changed = i == 0 || (trueColor ? (rs[i] != rs[i - 1] || gs[i] != gs[i - 1] || bs[i] != bs[i - 1]) : idx[i] != idx[i - 1]);
+                if (changed) {
+                    if (trueColor) appendTrueColor(out, '3', rs[i], gs[i], bs[i]);
+                    else out += ansi256(idx[i]);
+                }
+                size_t end = i + 1 < n ? starts[i + 1] : text.size();
+                out.append(text.data() + starts[i], end - starts[i]);
+            }
+            out += "\033[0m";
+            return out;
         };
     private:
         unsigned int r, g, b;
+
+        // The constructor keeps values above 255, every output clamps them here
+        static constexpr unsigned char channel(unsigned int v){
+            return static_cast<unsigned char>(std::min(v, 255u));
+        };
+
+        struct EscapeTable {
+            char text[256][12];
+            unsigned char size[256];
+        };
+        // ESC[38;5;Nm for layer '3', ESC[48;5;Nm for layer '4'
+        static constexpr EscapeTable makeEscapeTable(char layer){
+            EscapeTable t{};
+            for (int i = 0; i < 256; ++i) {
+                char *p = t.text[i];
+                int n = 0;
+                p[n++] = '\033'; p[n++] = '['; p[n++] = layer; p[n++] = '8'; p[n++] = ';'; p[n++] = '5'; p[n++] = ';';
+                if (i >= 100) p[n++] = static_cast<char>('0' + i / 100);
+                if (i >= 10) p[n++] = static_cast<char>('0' + i / 10 % 10);
+                p[n++] = static_cast<char>('0' + i % 10);
+                p[n++] = 'm';
+                t.size[i] = static_cast<unsigned char>(n);
+            }
+            return t;
+        };
+        static void appendTrueColor(std::string &out, char layer, unsigned char r, unsigned char g, unsigned char b){
+            char buf[24];
+            int n = 0;
+            buf[n++] = '\033'; buf[n++] = '['; buf[n++] = layer; buf[n++] = '8'; buf[n++] = ';'; buf[n++] = '2';
+            for (unsigned int v : {r, g, b}) {
+                buf[n++] = ';';
+                if (v >= 100) buf[n++] = static_cast<char>('0' + v / 100);
+                if (v >= 10) buf[n++] = static_cast<char>('0' + v / 10 % 10);
+                buf[n++] = static_cast<char>('0' + v % 10);
+            }
+            buf[n++] = 'm';
+            out.append(buf, static_cast<size_t>(n));
+        };
 };
 
-#endif // COLOR_256_H
\ No newline at end of file
+inline std::string_view Color256::ansi256(unsigned char index){
+    static constexpr EscapeTable table = makeEscapeTable('3');
+    return std::string_view(table.text[index], table.size[index]);
+}
+inline std::string_view Color256::ansiBackground256(unsigned char index){
+    static constexpr EscapeTable table = makeEscapeTable('4');
+    return std::string_view(table.text[index], table.size[index]);
+}
+
+#endif // COLOR_256_H
@@ -0,0 +1,385 @@
+/*
+ * The bench suite: f() / f_append() / print() / AFS_FMT against snprintf and
+ * std::ostringstream on the scenarios we log in practice. Reports ns/op, output
+ * bytes/op, heap allocations/op and throughput; --json writes the results so two commits
+ * can be compared with --baseline.
+ *
+ *   cmake -S . -B build && cmake --build build --target afs_bench
+ *   build/bench/afs_bench [--json out.json] [--baseline old.json] [--filter text]
+ *                         [--repeat n] [--min-time seconds]
+ *
+ *   g++ -std=c++17 -O2 -pthread -I.. afs_bench.cpp -o afs_bench
+ *
+ * Every row is the median of --repeat runs (default 5) of at least --min-time seconds
+ * (default 0.05) each, after a warm-up call, on fixed inputs.
+ */
+#include "../AsulFormatString.h"
+#include "bench_common.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <new>
+#include <sstream>
+#include <vector>
+
+// Counts operator new calls of the measured thread while enabled. GCC pairs the inlined
+// malloc/free of these replacements with new/delete expressions and warns wrongly.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+static size_t allocCount = 0;
+static bool allocCounting = false;
+void *operator new(size_t size) {
+    if (allocCounting) ++allocCount;
+    if (void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+
+// Swallows print() output, counting bytes
+class CountingSink : public AsulFormatString::Sink {
+public:
+    using Sink::write;
+    void write(const char *, size_t size) override { bytes += size; }
+    size_t bytes = 0;
+};
+
+struct Result {
+    std::string scenario, variant;
+    double ns = 0, bytes = 0, allocs = 0;
+    double mbPerSec() const { return ns > 0 ? bytes / ns * 1e3 : 0; }
+};
+
+struct Options {
+    std::string json, baseline, filter;
+    int repeat = 5;
+    double minTime = 0.05;
+};
+
+class Suite {
+public:
+    explicit Suite(const Options &opt) : opt(opt) {}
+
+    // fn performs one operation and returns the number of bytes it produced
+    template <typename Fn>
+    void run(const char *scenario, const char *variant, Fn &&fn) {
+        std::string name = std::string(scenario) + "/" + variant;
+        if (!opt.filter.empty() && name.find(opt.filter) == std::string::npos) return;
+        Result r;
+        r.scenario = scenario;
+        r.variant = variant;
+        r.bytes = static_cast<double>(fn()); // warm-up: caches, buffers, thread state
+
+        const size_t calls = 1000;
+        allocCount = 0;
+        allocCounting = true;
+        for (size_t i = 0; i < calls; ++i) benchKeep(fn());
+        allocCounting = false;
+        r.allocs = static_cast<double>(allocCount) / calls;
+
+        std::vector<double> runs;
+        for (int k = 0; k < opt.repeat; ++k) runs.push_back(benchNsPerOp([&] { benchKeep(fn()); }, opt.minTime));
+        std::sort(runs.begin(), runs.end());
+        r.ns = runs[runs.size() / 2];
+        results.push_back(r);
+        report(r);
+    }
+
+    void loadBaseline() {
+        if (opt.baseline.empty()) return;
+        std::ifstream in(opt.baseline);
+        if (!in) {
+            std::fprintf(stderr, "cannot read baseline %s\n", opt.baseline.c_str());
+            return;
+        }
+        // one result object per line, as writeJson emits them
+        std::string line;
+        while (std::getline(in, line)) {
+            std::string scenario = field(line, "scenario"), variant = field(line, "variant"), ns = field(line, "ns_per_op");
+            if (!scenario.empty() && !variant.empty() && !ns.empty()) baseline[scenario + "/" + variant] = std::atof(ns.c_str());
+        }
+    }
+
+    void header() const {
+        std::printf("%-17s %-14s %11s %10s %10s %11s%s\n", "scenario", "variant", "ns/op", "bytes/op", "allocs/op", "MB/s",
+                    baseline.empty() ? "" : "   vs baseline");
+    }
+
+    void writeJson() const {
+        if (opt.json.empty()) return;
+        std::ofstream out(opt.json);
+        out << "{\n  \"suite\": \"afs_bench\",\n";
+#ifdef __VERSION__
+        out << "  \"compiler\": \"" << __VERSION__ << "\",\n";
+#endif
+        out << "  \"repeat\": " << opt.repeat << ",\n  \"min_time_s\": " << opt.minTime << ",\n  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result &r = results[i];
+            out << "    {\"scenario\": \"" << r.scenario << "\", \"variant\": \"" << r.variant << "\", \"ns_per_op\": "
+                << std::fixed << std::setprecision(2) << r.ns << ", \"bytes_per_op\": " << r.bytes << ", \"allocs_per_op\": "
+                << r.allocs << ", \"mb_per_s\": " << r.mbPerSec() << ", \"ops_per_s\": " << std::setprecision(0) << 1e9 / r.ns
+                << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+        std::printf("\nwrote %s\n", opt.json.c_str());
+    }
+
+private:
+    const Options &opt;
+    std::vector<Result> results;
+    std::map<std::string, double> baseline;
+
+    void report(const Result &r) const {
+        std::printf("%-17s %-14s %11.1f %10.0f %10.2f %11.1f", r.scenario.c_str(), r.variant.c_str(), r.ns, r.bytes, r.allocs, r.mbPerSec());
+        auto it = baseline.find(r.scenario + "/" + r.variant);
+        if (it != baseline.end() && it->second > 0) std::printf("   %+6.1f%%", (r.ns / it->second - 1) * 100);
+        std::printf("\n");
+    }
+    static std::string field(const std::string &line, const char *key) {
+        std::string tag = std::string("\"") + key + "\": ";
+        size_t p = line.find(tag);
+        if (p == std::string::npos) return "";
+        p += tag.size();
+        if (line[p] == '"') {
+            size_t e = line.find('"', p + 1);
+            return e == std::string::npos ? "" : line.substr(p + 1, e - p - 1);
+        }
+        size_t e = line.find_first_of(",}", p);
+        return line.substr(p, e - p);
+    }
+};
+
+// A type the formatter only sees through std::any and a typed funcAdapter
+struct Money {
+    long cents;
+    const char *currency;
+};
+// The same value through an AsulFormatter specialization: written into the output directly
+struct Price {
+    long cents;
+    const char *currency;
+};
+template <>
+struct AsulFormatter<Price> {
+    void format(const Price &p, AsulFormatString::Sink &out) const {
+        char buf[48];
+        int n = std::snprintf(buf, sizeof buf, "%ld.%02ld %s", p.cents / 100, p.cents % 100, p.currency);
+        out.write(buf, static_cast<size_t>(n));
+    }
+};
+
+static std::string longTemplate() {
+    std::string t = "Usage report for {}\n";
+    while (t.size() < 2048) {
+        t += "This section explains how the service counts requests, retries and cache hits over the billing period. ";
+    }
+    return t + "\nTotal: {} requests, {} retries, {} cache hits.\n";
+}
+
+int main(int argc, char **argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto next = [&]() -> std::string { return i + 1 < argc ? argv[++i] : ""; };
+        if (a == "--json") opt.json = next();
+        else if (a == "--baseline") opt.baseline = next();
+        else if (a == "--filter") opt.filter = next();
+        else if (a == "--repeat") opt.repeat = std::max(1, std::atoi(next().c_str()));
+        else if (a == "--min-time") opt.minTime = std::atof(next().c_str());
+        else {
+            std::printf("usage: %s [--json out.json] [--baseline old.json] [--filter text] [--repeat n] [--min-time seconds]\n", argv[0]);
+            return a == "--help" ? 0 : 2;
+        }
+    }
+
+    AsulFormatString &afs = asul_formatter();
+    afs.installColorFormatAdapter();
+    afs.installLogLabelAdapter();
+    afs.installFuncFormatAdapter({{"upper", [](const AsulFormatString::VariantType &v) {
+        std::string s = AsulFormatString::variantToString(v);
+        for (char &c : s) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        return s;
+    }}});
+    afs.installTypedFuncAdapter<Money>("money", [](const Money &m) {
+        char buf[48];
+        int n = std::snprintf(buf, sizeof buf, "%ld.%02ld %s", m.cents / 100, m.cents % 100, m.currency);
+        return std::string(buf, static_cast<size_t>(n));
+    });
+    CountingSink counting;
+    afs.setPrintSink(&counting);
+    auto printed = [&](auto &&call) {
+        size_t before = counting.bytes;
+        call();
+        return counting.bytes - before;
+    };
+
+    Suite suite(opt);
+    suite.loadBaseline();
+    suite.header();
+    std::string buf;
+    char cbuf[4096];
+
+    // Short log line with a colored (INFO) label
+    {
+        const std::string info = afs.f("(INFO)");
+        const std::string path = "/api/v1/items";
+        int id = 4711;
+        double ms = 12.5;
+        suite.run("log_line", "f", [&] { return afs.f("(INFO) request {} {} took {} ms", id, path, ms).size(); });
+        suite.run("log_line", "AFS_FMT", [&] { return afs.f(AFS_FMT("(INFO) request {} {} took {} ms"), id, path, ms).size(); });
+        suite.run("log_line", "f_append", [&] { buf.clear(); return afs.f_append(buf, "(INFO) request {} {} took {} ms", id, path, ms).size(); });
+        suite.run("log_line", "print", [&] { return printed([&] { afs.print("(INFO) request {} {} took {} ms", id, path, ms); }); });
+        suite.run("log_line", "snprintf", [&] {
+            return static_cast<size_t>(std::snprintf(cbuf, sizeof cbuf, "%s request %d %s took %g ms", info.c_str(), id, path.c_str(), ms));
+        });
+        suite.run("log_line", "ostringstream", [&] {
+            std::ostringstream oss;
+            oss << info << " request " << id << " " << path << " took " << ms << " ms";
+            return oss.str().size();
+        });
+    }
+    // Color format adapters around arguments
+    {
+        const std::string red = afs.f("{RED}", ""), green = afs.f("{GREEN}", "");
+        const std::string redOpen = red.substr(0, red.find("\033[0m")), greenOpen = green.substr(0, green.find("\033[0m"));
+        suite.run("color", "f", [&] { return afs.f("status {RED}, fallback {GREEN}", "DOWN", "UP").size(); });
+        suite.run("color", "AFS_FMT", [&] { return afs.f(AFS_FMT("status {RED}, fallback {GREEN}"), "DOWN", "UP").size(); });
+        suite.run("color", "snprintf", [&] {
+            return static_cast<size_t>(std::snprintf(cbuf, sizeof cbuf, "status %sDOWN\033[0m, fallback %sUP\033[0m", redOpen.c_str(), greenOpen.c_str()));
+        });
+        suite.run("color", "ostringstream", [&] {
+            std::ostringstream oss;
+            oss << "status " << redOpen << "DOWN" << "\033[0m, fallback " << greenOpen << "UP" << "\033[0m";
+            return oss.str().size();
+        });
+    }
+    // [[SETW]] table row
+    {
+        const std::string name = "worker-17";
+        int jobs = 1234;
+        double load = 0.8731;
+        suite.run("table_row", "f", [&] {
+            return afs.f("[[LEFT]][[SETW:12]]{}[[RIGHT]][[SETW:8]]{}[[SETW:10]][[FIXED]][[PREC:2]]{}", name, jobs, load).size();
+        });
+        suite.run("table_row", "AFS_FMT", [&] {
+            return afs.f(AFS_FMT("[[LEFT]][[SETW:12]]{}[[RIGHT]][[SETW:8]]{}[[SETW:10]][[FIXED]][[PREC:2]]{}"), name, jobs, load).size();
+        });
+        suite.run("table_row", "snprintf", [&] {
+            return static_cast<size_t>(std::snprintf(cbuf, sizeof cbuf, "%-12s%8d%10.2f", name.c_str(), jobs, load));
+        });
+        suite.run("table_row", "ostringstream", [&] {
+            std::ostringstream oss;
+            oss << std::left << std::setw(12) << name << std::right << std::setw(8) << jobs << std::setw(10) << std::fixed
+                << std::setprecision(2) << load;
+            return oss.str().size();
+        });
+    }
+    // funcAdapter call
+    {
+        const std::string user = "alice";
+        suite.run("func_adapter", "f", [&] { return afs.f("user {upper} logged in", user).size(); });
+        suite.run("func_adapter", "snprintf", [&] {
+            std::string up = user;
+            for (char &c : up) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+            return static_cast<size_t>(std::snprintf(cbuf, sizeof cbuf, "user %s logged in", up.c_str()));
+        });
+        suite.run("func_adapter", "ostringstream", [&] {
+            std::string up = user;
+            for (char &c : up) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+            std::ostringstream oss;
+            oss << "user " << up << " logged in";
+            return oss.str().size();
+        });
+    }
+    // Custom type through std::any and installTypedFuncAdapter
+    {
+        Money price{129950, "EUR"};
+        suite.run("any_custom", "f", [&] { return afs.f("total {money}", price).size(); });
+        suite.run("any_custom", "snprintf", [&] {
+            return static_cast<size_t>(std::snprintf(cbuf, sizeof cbuf, "total %ld.%02ld %s", price.cents / 100, price.cents % 100, price.currency));
+        });
+        suite.run("any_custom", "ostringstream", [&] {
+            std::ostringstream oss;
+            oss << "total " << price.cents / 100 << "." << std::setw(2) << std::setfill('0') << price.cents % 100 << " " << price.currency;
+            return oss.str().size();
+        });
+    }
+    // Custom type through AsulFormatter
+    {
+        Price price{129950, "EUR"};
+        suite.run("formatter_custom", "f", [&] { return afs.f("total {}", price).size(); });
+        suite.run("formatter_custom", "f_append", [&] { buf.clear(); return afs.f_append(buf, "total {}", price).size(); });
+        suite.run("formatter_custom", "snprintf", [&] {
+            return static_cast<size_t>(std::snprintf(cbuf, sizeof cbuf, "total %ld.%02ld %s", price.cents / 100, price.cents % 100, price.currency));
+        });
+    }
+    // Counters and byte sizes: size_t / uint64_t / long / float arguments
+    {
+        size_t bytes = 734003200;
+        uint64_t requests = 18446744073709ULL;
+        long delta = -42;
+        float ratio = 0.8725f;
+        suite.run("counters", "f", [&] { return afs.f("{} bytes, {} requests, delta {}, hit ratio {}", bytes, requests, delta, ratio).size(); });
+        suite.run("counters", "f_append", [&] {
+            buf.clear();
+            return afs.f_append(buf, "{} bytes, {} requests, delta {}, hit ratio {}", bytes, requests, delta, ratio).size();
+        });
+        suite.run("counters", "snprintf", [&] {
+            return static_cast<size_t>(std::snprintf(cbuf, sizeof cbuf, "%zu bytes, %llu requests, delta %ld, hit ratio %g", bytes,
+                                                     static_cast<unsigned long long>(requests), delta, static_cast<double>(ratio)));
+        });
+        suite.run("counters", "ostringstream", [&] {
+            std::ostringstream oss;
+            oss << bytes << " bytes, " << requests << " requests, delta " << delta << ", hit ratio " << ratio;
+            return oss.str().size();
+        });
+    }
+    // 64 latencies in microseconds joined by [[JOIN]], against joining per element
+    {
+        std::vector<uint32_t> latencies(64);
+        for (size_t i = 0; i < latencies.size(); ++i) latencies[i] = static_cast<uint32_t>(37 + i * i * 131 % 9973);
+        suite.run("range_join", "f", [&] { return afs.f("latencies_us=[[JOIN:,]]{}", latencies).size(); });
+        suite.run("range_join", "f_append", [&] { buf.clear(); return afs.f_append(buf, "latencies_us=[[JOIN:,]]{}", latencies).size(); });
+        suite.run("range_join", "per_element", [&] {
+            std::string joined;
+            for (size_t i = 0; i < latencies.size(); ++i) joined += (i ? "," : "") + afs.f("{}", latencies[i]);
+            return ("latencies_us=" + joined).size();
+        });
+        suite.run("range_join", "ostringstream", [&] {
+            std::ostringstream oss;
+            oss << "latencies_us=";
+            for (size_t i = 0; i < latencies.size(); ++i) oss << (i ? "," : "") << latencies[i];
+            return oss.str().size();
+        });
+    }
+    // ~2 KiB of text with four placeholders
+    {
+        const std::string tmpl = longTemplate();
+        std::string ctmpl = tmpl;
+        for (size_t p; (p = ctmpl.find("{}")) != std::string::npos;) ctmpl.replace(p, 2, "%s");
+        suite.run("long_template", "f", [&] { return afs.f(tmpl, "acme", 182734, 1203, 99120).size(); });
+        suite.run("long_template", "f_append", [&] { buf.clear(); return afs.f_append(buf, tmpl, "acme", 182734, 1203, 99120).size(); });
+        suite.run("long_template", "print", [&] { return printed([&] { afs.print(tmpl, "acme", 182734, 1203, 99120); }); });
+        suite.run("long_template", "snprintf", [&] {
+            return static_cast<size_t>(std::snprintf(cbuf, sizeof cbuf, ctmpl.c_str(), "acme", "182734", "1203", "99120"));
+        });
+        suite.run("long_template", "ostringstream", [&] {
+            std::ostringstream oss;
+            size_t a = tmpl.find("{}"), b = tmpl.find("{}", a + 2), c = tmpl.find("{}", b + 2), d = tmpl.find("{}", c + 2);
+            oss << tmpl.substr(0, a) << "acme" << tmpl.substr(a + 2, b - a - 2) << 182734 << tmpl.substr(b + 2, c - b - 2) << 1203
+                << tmpl.substr(c + 2, d - c - 2) << 99120 << tmpl.substr(d + 2);
+            return oss.str().size();
+        });
+    }
+
+    afs.setPrintSink(nullptr);
+    suite.writeJson();
+    return 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * (LABEL) / {FORMAT} expansion: compiling a format (validate() with the format cache off,
+ * which expands every reference) vs the former std::regex passes, then the compile cost
+ * per colored segment as the segment count grows, which stays flat now that each
+ * reference pushes a view instead of rebuilding the string.
+ *
+ *   g++ -std=c++17 -O2 -I.. bench_adapter_expansion.cpp -o bench_adapter_expansion
+ */
+#include "../AsulFormatString.h"
+#include "bench_common.h"
+#include <regex>
+
+// The regex based processLabelAdapter / processAdapter pair that f() used before
+static std::string regexExpand(const std::string &fmt, const AsulFormatString::AdapterMap &labels,
+                               const AsulFormatString::AdapterMap &formats) {
+    auto pass = [](const std::string &src, const char *re, const AsulFormatString::AdapterMap &mp) {
+        std::regex pattern(re);
+        std::smatch match;
+        std::string temp = src, processed;
+        while (std::regex_search(temp, match, pattern)) {
+            processed += temp.substr(0, match.position());
+            auto it = mp.find(match[1]);
+            processed += it != mp.end() ? it->second : std::string(match[0]);
+            temp = match.suffix();
+        }
+        return processed + temp;
+    };
+    return pass(pass(fmt, R"(\((\w+)\))", labels), R"(\{(\w+)\})", formats);
+}
+
+int main() {
+    AsulFormatString afs;
+    afs.installColorFormatAdapter();
+    afs.installResetLabelAdapter();
+    afs.installLogLabelAdapter();
+    AsulFormatString::AdapterMap labels = {
+        {"RESET", "\033[0m"},
+        {"SUCCESS", afs.f("{GREEN}", "[Success]")},
+        {"INFO", afs.f("{LIGHT_BLUE}", "[Info===]")},
+        {"WARN", afs.f("{YELLOW}", "[Warn===]")},
+        {"ERROR", afs.f("{RED}", "[Error==]")},
+    };
+    AsulFormatString::AdapterMap formats;
+    for (const char *name : {"RED", "GREEN", "YELLOW", "LIGHT_BLUE", "UNDERLINE"}) {
+        formats[name] = afs.f(std::string("{") + name + "}");
+    }
+
+    std::string shortLine = "(INFO) request {} served by {GREEN} in {} ms (RESET)";
+    std::string longTemplate;
+    while (longTemplate.size() < 64 * 1024) {
+        longTemplate += "(WARN) disk {YELLOW} at {}% on host {UNDERLINE}, see (nolabel) {nofmt} for details. ";
+        longTemplate += "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor. (RESET)\n";
+    }
+
+    afs.setFormatCacheCapacity(0);
+    std::printf("%-22s %14s %14s %9s\n", "scenario", "regex ns/op", "compile ns/op", "speedup");
+    for (const std::string *fmt : {&shortLine, &longTemplate}) {
+        // without arguments every {} prints as written, so f() shows the bare expansion
+        if (regexExpand(*fmt, labels, formats) != afs.f(*fmt)) {
+            std::printf("output mismatch\n");
+            return 1;
+        }
+        double oldNs = benchNsPerOp([&] { benchKeep(regexExpand(*fmt, labels, formats).size()); });
+        double newNs = benchNsPerOp([&] { benchKeep(afs.validate(*fmt).ok()); });
+        std::printf("%-22s %14.0f %14.0f %8.1fx\n", fmt == &shortLine ? "short log line" : "64 KiB template",
+                    oldNs, newNs, oldNs / newNs);
+    }
+
+    std::printf("\n%-22s %14s %14s\n", "colored segments", "ns/compile", "ns/segment");
+    for (size_t segments : {256, 1024, 4096, 16384}) {
+        std::string fmt;
+        for (size_t i = 0; i < segments; ++i) fmt += i % 2 ? "{GREEN}ok (RESET)" : "(WARN) {YELLOW}x ";
+        double ns = benchNsPerOp([&] { benchKeep(afs.f(fmt).size()); });
+        std::printf("%-22zu %14.0f %14.1f\n", segments, ns, ns / static_cast<double>(segments));
+    }
+    return 0;
+}
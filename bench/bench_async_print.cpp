@@ -0,0 +1,75 @@
+/*
+ * Caller side latency of print(): synchronous output vs AsulAsyncSink, against a fast
+ * target (/dev/null) and a slow one that stalls like a terminal or a full pipe.
+ *
+ *   g++ -std=c++17 -O2 -pthread -I.. bench_async_print.cpp -o bench_async_print
+ */
+#include "../AsulAsync.h"
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <thread>
+#include <vector>
+
+// Costs a fixed stall per write, like a slow consumer on the other end of a pipe
+class SlowSink : public AsulFormatString::Sink {
+public:
+    explicit SlowSink(AsulFormatString::Sink &next) : next(next) {}
+    void write(const char *data, size_t size) override {
+        auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(20);
+        while (std::chrono::steady_clock::now() < until) {}
+        next.write(data, size);
+    }
+private:
+    AsulFormatString::Sink &next;
+};
+
+static void report(const char *name, std::vector<double> &ns) {
+    std::sort(ns.begin(), ns.end());
+    auto pct = [&](double p) { return ns[static_cast<size_t>(p * (ns.size() - 1))]; };
+    std::printf("%-32s p50 %9.0f ns   p99 %9.0f ns   p99.9 %9.0f ns\n", name, pct(0.50), pct(0.99), pct(0.999));
+}
+
+static void measure(const char *name, AsulFormatString::Sink &sink, size_t calls) {
+    AsulFormatString &afs = asul_formatter();
+    afs.setPrintSink(&sink);
+    std::vector<double> ns;
+    ns.reserve(calls);
+    for (size_t i = 0; i < calls; ++i) {
+        auto t0 = std::chrono::steady_clock::now();
+        print("(INFO) request {} took {GREEN} [[FIXED]][[PREC:2]]{} ms[[ENDL]]", static_cast<int>(i), "GET /index.html", 0.25 * i);
+        ns.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count());
+        // a request thread does other work between log lines
+        if (i % 64 == 0) std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    sink.flush();
+    afs.setPrintSink(nullptr);
+    report(name, ns);
+}
+
+int main() {
+    asul_formatter().installColorFormatAdapter();
+    asul_formatter().installLogLabelAdapter();
+    int fd = ::open("/dev/null", O_WRONLY);
+    AsulFormatString::FdSink devNull(fd);
+    SlowSink slow(devNull);
+    const size_t calls = 100000;
+
+    measure("sync  -> /dev/null", devNull, calls);
+    {
+        AsulAsyncSink async(devNull);
+        measure("async -> /dev/null", async, calls);
+    }
+    measure("sync  -> slow target", slow, calls);
+    {
+        AsulAsyncSink async(slow);
+        measure("async -> slow target", async, calls);
+    }
+    {
+        AsulAsyncSink async(slow, 1024, AsulAsyncSink::Overflow::DropNewest);
+        measure("async -> slow target, drop newest", async, calls);
+        std::printf("%-32s dropped %zu of %zu\n", "", async.dropped(), calls);
+    }
+    ::close(fd);
+    return 0;
+}
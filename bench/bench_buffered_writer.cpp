@@ -0,0 +1,104 @@
+/*
+ * write syscalls and time per 10k print() lines: std::cout (the default print target) vs
+ * BufferedFdSink with different flush policies, with stdout on a file and on a terminal.
+ * Linux only: syscalls are read from /proc/self/io, the terminal is a pseudo terminal.
+ *
+ *   g++ -std=c++17 -O2 -pthread -I.. bench_buffered_writer.cpp -o bench_buffered_writer
+ */
+#include "../AsulFormatString.h"
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
+#include <functional>
+#include <sys/wait.h>
+#include <thread>
+
+static long writeSyscalls() {
+    std::ifstream io("/proc/self/io");
+    std::string key;
+    long value = 0;
+    while (io >> key >> value) {
+        if (key == "syscw:") return value;
+    }
+    return -1;
+}
+
+// Runs one scenario in a child whose stdout is a file or a pseudo terminal, so every
+// run starts with fresh stdio buffering decided by the fd it sees
+static void scenario(const char *name, bool terminal, const std::function<void()> &setup,
+                     const std::function<void()> &teardown) {
+    const int lines = 10000;
+    int report[2];
+    if (pipe(report) != 0) return;
+    std::fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(report[0]);
+        int out;
+        std::thread drain;
+        if (terminal) {
+            int master = posix_openpt(O_RDWR | O_NOCTTY);
+            grantpt(master);
+            unlockpt(master);
+            out = open(ptsname(master), O_WRONLY | O_NOCTTY);
+            drain = std::thread([master] {
+                char buf[65536];
+                while (read(master, buf, sizeof buf) > 0) {}
+            });
+            drain.detach();
+        } else {
+            out = open("/dev/null", O_WRONLY);
+        }
+        dup2(out, 1);
+        close(out);
+        // what a process started on this fd would get: line buffered on a terminal
+        std::setvbuf(stdout, nullptr, terminal ? _IOLBF : _IOFBF, BUFSIZ);
+        asul_formatter().installLogLabelAdapter();
+        setup();
+        long before = writeSyscalls();
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < lines; ++i) {
+            print("(INFO) request {} served in [[FIXED]][[PREC:2]]{} ms[[ENDL]]", i, 0.25 * i);
+        }
+        teardown();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+        long calls = writeSyscalls() - before;
+        dprintf(report[1], "%-44s %-9s %8ld syscalls   %7.0f ns/line\n", name, terminal ? "terminal" : "file", calls, ns / lines);
+        _exit(0);
+    }
+    close(report[1]);
+    char buf[256];
+    ssize_t n;
+    while ((n = read(report[0], buf, sizeof buf)) > 0) fwrite(buf, 1, static_cast<size_t>(n), stdout);
+    close(report[0]);
+    waitpid(pid, nullptr, 0);
+}
+
+int main() {
+    std::printf("write syscalls per 10k lines\n");
+    for (bool terminal : {false, true}) {
+        scenario("std::cout (default print target)", terminal, [] {}, [] { std::cout.flush(); });
+
+        static AsulFormatString::BufferedFdSink *sink = nullptr;
+        auto use = [](AsulFormatString::BufferedFdSink::FlushPolicy policy) {
+            return [policy] {
+                sink = new AsulFormatString::BufferedFdSink(1, policy);
+                asul_formatter().setPrintSink(sink);
+            };
+        };
+        auto done = [] {
+            asul_formatter().setPrintSink(nullptr);
+            delete sink;
+        };
+        scenario("BufferedFdSink, default (newline on tty)", terminal, use(AsulFormatString::BufferedFdSink::FlushPolicy()), done);
+        AsulFormatString::BufferedFdSink::FlushPolicy timed = AsulFormatString::BufferedFdSink::explicitFlush();
+        timed.timeThreshold = std::chrono::milliseconds(16);
+        scenario("BufferedFdSink, 16 ms time threshold", terminal, use(timed), done);
+        AsulFormatString::BufferedFdSink::FlushPolicy sized = AsulFormatString::BufferedFdSink::explicitFlush();
+        sized.sizeThreshold = 4096;
+        scenario("BufferedFdSink, 4 KiB size threshold", terminal, use(sized), done);
+        scenario("BufferedFdSink, explicit", terminal, use(AsulFormatString::BufferedFdSink::explicitFlush()), done);
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+/*
+ * Rainbow text per frame: one ostringstream escape per code point (the former
+ * Color256::toANSI256) vs table escapes vs Color256::gradient, plus the palette index
+ * kernel alone, scalar vs index256Batch.
+ *
+ *   g++ -std=c++17 -O2 -I.. bench_color_gradient.cpp -o bench_color_gradient
+ */
+#include "../Color256.h"
+#include "bench_common.h"
+#include <cmath>
+#include <sstream>
+#include <vector>
+
+// What toANSI256 did before the tables
+static std::string streamEscape(unsigned int r, unsigned int g, unsigned int b) {
+    std::ostringstream oss;
+    oss << "\033[38;5;" << (16 + (36 * (r * 6 / 256)) + (6 * (g * 6 / 256)) + (b * 6 / 256)) << "m";
+    return oss.str();
+}
+
+static Color256 rainbow(size_t i, int frame) {
+    return Color256::rgba(static_cast<unsigned char>((std::sin(0.3 * i + frame * 0.3 + 0) + 1) * 127.5),
+                          static_cast<unsigned char>((std::sin(0.3 * i + frame * 0.3 + 2) + 1) * 127.5),
+                          static_cast<unsigned char>((std::sin(0.3 * i + frame * 0.3 + 4) + 1) * 127.5), 1);
+}
+
+// Per code point loop of the examples before gradient()
+template <typename Escape>
+static std::string perCodePoint(const std::string &text, int frame, Escape &&escape) {
+    std::string out;
+    size_t cp = 0;
+    for (size_t i = 0; i < text.size();) {
+        size_t j = i + 1;
+        while (j < text.size() && (static_cast<unsigned char>(text[j]) & 0xC0) == 0x80) ++j;
+        out += escape(rainbow(cp++, frame));
+        out.append(text, i, j - i);
+        i = j;
+    }
+    out += "\033[0m";
+    return out;
+}
+
+int main() {
+    std::string line;
+    while (line.size() < 80) line += "Flowing Rainbow Text 彩虹文字 ";
+    int frame = 0;
+    size_t bytes[3] = {0, 0, 0};
+
+    double stream = benchNsPerOp([&] {
+        std::string s = perCodePoint(line, ++frame, [](const Color256 &c) { return streamEscape(c.getR(), c.getG(), c.getB()); });
+        bytes[0] = s.size();
+        benchKeep(s.size());
+    });
+    double table = benchNsPerOp([&] {
+        std::string s = perCodePoint(line, ++frame, [](const Color256 &c) { return c.toANSI256View(); });
+        bytes[1] = s.size();
+        benchKeep(s.size());
+    });
+    double grad = benchNsPerOp([&] {
+        std::string s = Color256::gradient(line, [&](size_t i) { return rainbow(i, frame); });
+        ++frame;
+        bytes[2] = s.size();
+        benchKeep(s.size());
+    });
+    std::printf("one %zu byte line per frame\n", line.size());
+    std::printf("  %-34s %9.0f ns/frame  %5zu bytes\n", "ostringstream escape per char", stream, bytes[0]);
+    std::printf("  %-34s %9.0f ns/frame  %5zu bytes\n", "table escape per char", table, bytes[1]);
+    std::printf("  %-34s %9.0f ns/frame  %5zu bytes\n", "Color256::gradient", grad, bytes[2]);
+
+    const size_t n = 4096;
+    std::vector<unsigned char> rs(n), gs(n), bs(n), out(n);
+    for (size_t i = 0; i < n; ++i) {
+        rs[i] = static_cast<unsigned char>(i * 7);
+        gs[i] = static_cast<unsigned char>(i * 13);
+        bs[i] = static_cast<unsigned char>(i * 29);
+    }
+    double scalar = benchNsPerOp([&] {
+        for (size_t i = 0; i < n; ++i) out[i] = Color256::index256(rs[i], gs[i], bs[i]);
+        benchKeep(out[n - 1]);
+    });
+    double batch = benchNsPerOp([&] {
+        Color256::index256Batch(rs.data(), gs.data(), bs.data(), out.data(), n);
+        benchKeep(out[n - 1]);
+    });
+    std::printf("palette index of %zu pixels\n", n);
+    std::printf("  %-34s %9.0f ns  %6.2f ns/px\n", "scalar index256", scalar, scalar / n);
+    std::printf("  %-34s %9.0f ns  %6.2f ns/px\n", "index256Batch", batch, batch / n);
+    return 0;
+}
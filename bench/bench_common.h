@@ -0,0 +1,50 @@
+#ifndef AFS_BENCH_COMMON_H
+#define AFS_BENCH_COMMON_H
+
+#include "../AsulFormatString.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+// Runs fn in doubling batches until one batch takes at least minSeconds,
+// returns the mean nanoseconds per call of that batch.
+template <typename Fn>
+inline double benchNsPerOp(Fn &&fn, double minSeconds = 0.2) {
+    using clock = std::chrono::steady_clock;
+    for (size_t iters = 1;; iters *= 2) {
+        auto t0 = clock::now();
+        for (size_t i = 0; i < iters; ++i) fn();
+        double ns = std::chrono::duration<double, std::nano>(clock::now() - t0).count();
+        if (ns >= minSeconds * 1e9) return ns / static_cast<double>(iters);
+    }
+}
+
+// Keeps results observable so the optimizer cannot drop the measured work (per thread)
+inline void benchKeep(size_t v) {
+    static thread_local volatile size_t sink = 0;
+    sink = sink + v;
+}
+
+// Copies into a 64 KiB scratch buffer, what a buffered writer would cost without the I/O;
+// counts the bytes so the output stays observable
+class ScratchSink : public AsulFormatString::Sink {
+public:
+    using Sink::write;
+    void write(const char *data, size_t size) override {
+        for (size_t n; size > 0; data += n, size -= n) {
+            if (used == sizeof scratch) used = 0;
+            n = std::min(size, sizeof scratch - used);
+            std::memcpy(scratch + used, data, n);
+            used += n;
+            bytes += n;
+        }
+    }
+    size_t bytes = 0;
+private:
+    char scratch[64 * 1024];
+    size_t used = 0;
+};
+
+#endif // AFS_BENCH_COMMON_H
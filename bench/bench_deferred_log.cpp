@@ -0,0 +1,64 @@
+/*
+ * Caller side cost of one log line: formatting on the calling thread (sync print and
+ * AsulAsyncSink) vs AsulDeferredLogger, which only copies a format id and argument bytes.
+ *
+ *   g++ -std=c++17 -O2 -pthread -I.. bench_deferred_log.cpp -o bench_deferred_log
+ */
+#include "../AsulAsync.h"
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <thread>
+#include <vector>
+
+template <typename Fn>
+static void measure(const char *name, size_t calls, Fn &&logLine) {
+    std::vector<double> ns;
+    ns.reserve(calls);
+    for (size_t i = 0; i < calls; ++i) {
+        auto t0 = std::chrono::steady_clock::now();
+        logLine(static_cast<int>(i));
+        ns.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count());
+        // a request thread does other work between log lines
+        if (i % 64 == 0) std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    std::sort(ns.begin(), ns.end());
+    auto pct = [&](double p) { return ns[static_cast<size_t>(p * (ns.size() - 1))]; };
+    std::printf("%-28s p50 %7.0f ns   p99 %7.0f ns   p99.9 %7.0f ns\n", name, pct(0.50), pct(0.99), pct(0.999));
+}
+
+int main() {
+    AsulFormatString &afs = asul_formatter();
+    afs.installColorFormatAdapter();
+    afs.installLogLabelAdapter();
+    int fd = ::open("/dev/null", O_WRONLY);
+    AsulFormatString::FdSink devNull(fd);
+    const size_t calls = 100000;
+    const std::string path = "/api/v1/items";
+
+    afs.setPrintSink(&devNull);
+    measure("sync print", calls, [&](int i) {
+        print("(INFO) {} {} took {GREEN} [[FIXED]][[PREC:2]]{} ms[[ENDL]]", i, path, "OK", 0.25 * i);
+    });
+    {
+        AsulAsyncSink async(devNull);
+        afs.setPrintSink(&async);
+        measure("AsulAsyncSink print", calls, [&](int i) {
+            print("(INFO) {} {} took {GREEN} [[FIXED]][[PREC:2]]{} ms[[ENDL]]", i, path, "OK", 0.25 * i);
+        });
+        afs.setPrintSink(nullptr);
+    }
+    {
+        AsulDeferredLogger log(devNull);
+        measure("deferred, runtime format", calls, [&](int i) {
+            log.log("(INFO) {} {} took {GREEN} [[FIXED]][[PREC:2]]{} ms[[ENDL]]", i, path, "OK", 0.25 * i);
+        });
+        measure("deferred, AFS_FMT", calls, [&](int i) {
+            log.log(AFS_FMT("(INFO) {} {} took {GREEN} [[FIXED]][[PREC:2]]{} ms[[ENDL]]"), i, path,
+                    AsulDeferredLogger::literal("OK"), 0.25 * i);
+        });
+        log.flush();
+    }
+    ::close(fd);
+    return 0;
+}
@@ -0,0 +1,62 @@
+/*
+ * Cost of padding by terminal columns instead of bytes: ns to measure a cell with
+ * DisplayWidth::of (SSE2 ASCII run + UTF-8 decode) against a byte-at-a-time scalar count,
+ * and ns per "[[LEFT]][[SETW:24]]{}|" cell for ASCII, ANSI colored and CJK text.
+ *
+ *   g++ -std=c++17 -O2 -I.. bench_display_width.cpp -o bench_display_width
+ */
+#include "../AsulFormatString.h"
+#include "bench_common.h"
+
+// The same count without the SIMD run: ASCII a byte at a time, other code points and
+// escapes handed to DisplayWidth one at a time
+static size_t scalarWidth(std::string_view s) {
+    size_t width = 0;
+    for (size_t i = 0; i < s.size(); ) {
+        unsigned char c = static_cast<unsigned char>(s[i]);
+        size_t len = 1;
+        if (c == 27) {
+            while (i + len < s.size() && !(s[i + len] >= '@' && s[i + len] <= '~' && len > 1)) ++len;
+            len = std::min(len + 1, s.size() - i);
+        } else if (c >= 0x80) {
+            len = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : 2;
+            len = std::min(len, s.size() - i);
+        } else {
+            ++width;
+            ++i;
+            continue;
+        }
+        width += AsulFormatString::DisplayWidth::of(s.substr(i, len));
+        i += len;
+    }
+    return width;
+}
+
+int main() {
+    AsulFormatString &afs = asul_formatter();
+    afs.installColorFormatAdapter();
+    struct Text { const char *name; std::string value; };
+    const Text texts[] = {
+        {"ascii, 12 bytes", "request-4711"},
+        {"ascii, 64 bytes", std::string(64, 'x')},
+        {"ansi colored", afs.f("{RED}", "request-4711")},
+        {"cjk, 7 chars", "请求已完成处理"},
+        {"mixed", "host-01 主机 ok"},
+    };
+    std::string out;
+    out.reserve(4096);
+    AsulFormatString::StringSink sink(out);
+    std::printf("%-18s %12s %12s %14s\n", "text", "of() ns", "scalar ns", "SETW cell ns");
+    for (const Text &t : texts) {
+        std::string_view v = t.value;
+        double simd = benchNsPerOp([&] { benchKeep(AsulFormatString::DisplayWidth::of(v)); });
+        double scalar = benchNsPerOp([&] { benchKeep(scalarWidth(v)); });
+        double cell = benchNsPerOp([&] {
+            out.clear();
+            print(sink, "[[LEFT]][[SETW:24]]{}|", v);
+            benchKeep(out.size());
+        });
+        std::printf("%-18s %12.1f %12.1f %14.1f\n", t.name, simd, scalar, cell);
+    }
+    return 0;
+}
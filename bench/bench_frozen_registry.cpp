@@ -0,0 +1,51 @@
+/*
+ * Adapter lookups with the unordered_map registry vs after freeze(), with 10, 1k and 100k
+ * registered labels and formats. Measured on validate() (compile only) and on f() with the
+ * compiled format cache disabled, both of which resolve every (NAME) / {NAME} of the format.
+ *
+ *   g++ -std=c++17 -O2 -I.. bench_frozen_registry.cpp -o bench_frozen_registry
+ */
+#include "../AsulFormatString.h"
+#include "bench_common.h"
+#include <random>
+
+static void run(size_t count, const char *prefix) {
+    AsulFormatString afs;
+    AsulFormatString::AdapterMap labels, formats;
+    for (size_t i = 0; i < count; ++i) {
+        labels[prefix + std::to_string(i)] = "label" + std::to_string(i);
+        formats[prefix + std::to_string(i)] = "<{}>";
+    }
+    afs.installLabelAdapter(labels);
+    afs.installFormatAdapter(formats);
+    afs.setFormatCacheCapacity(0);
+
+    // 32 label and 32 format references, a quarter of them unknown names
+    std::mt19937 rng(42);
+    std::string fmt;
+    for (int k = 0; k < 32; ++k) {
+        size_t id = rng() % (count + count / 3 + 1);
+        fmt += "(" + (prefix + std::to_string(id)) + ") {" + (prefix + std::to_string(rng() % count)) + "} ";
+    }
+
+    auto measure = [&] {
+        double compile = benchNsPerOp([&] { benchKeep(afs.validate(fmt).ok()); });
+        double format = benchNsPerOp([&] { benchKeep(afs.f(fmt, 1).size()); });
+        return std::make_pair(compile, format);
+    };
+    auto maps = measure();
+    auto t0 = std::chrono::steady_clock::now();
+    afs.freeze();
+    double build = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    auto frozen = measure();
+    std::printf("%8zu  %-16s  compile %7.0f -> %7.0f ns   f() %7.0f -> %7.0f ns   freeze %8.2f ms\n",
+                count, prefix, maps.first, frozen.first, maps.second, frozen.second, build);
+}
+
+int main() {
+    std::printf("%8s  %-16s  64 references per format, maps -> frozen\n", "names", "key prefix");
+    for (const char *prefix : {"L", "app_settings_msg_"}) {
+        for (size_t count : {size_t(10), size_t(1000), size_t(100000)}) run(count, prefix);
+    }
+    return 0;
+}
@@ -0,0 +1,60 @@
+/*
+ * Literal runs in large, mostly literal templates: the MetaScanner kernels alone
+ * (scalar / SSE2 / AVX2) and compiling + formatting a whole template with the compiled
+ * format cache disabled, in GB/s of template text.
+ *
+ *   g++ -std=c++17 -O2 -I.. bench_literal_scan.cpp -o bench_literal_scan
+ */
+#include "../AsulFormatString.h"
+#include "bench_common.h"
+
+// Paragraphs of text with a placeholder row every ~2 KiB, like a banner or translated help page
+static std::string makeTemplate(size_t bytes) {
+    const char *para = "The quick brown fox jumps over the lazy dog while the server keeps answering requests; ";
+    std::string t;
+    size_t n = 0;
+    while (t.size() < bytes) {
+        t += para;
+        if (++n % 24 == 0) t += "value {} [[SETW:8]]{}[[ENDL]]";
+    }
+    return t;
+}
+
+// Walks the whole text from meta byte to meta byte, as compileFormat does
+static double kernelGBs(AsulFormatString::MetaScanner::ScanFn scan, const std::string &text) {
+    double ns = benchNsPerOp([&] {
+        size_t hits = 0;
+        for (size_t i = scan(text.data(), text.size()); i < text.size(); ++hits) {
+            i += 1 + scan(text.data() + i + 1, text.size() - i - 1);
+        }
+        benchKeep(hits);
+    });
+    return static_cast<double>(text.size()) / ns;
+}
+
+int main() {
+    using Scanner = AsulFormatString::MetaScanner;
+    std::printf("runtime kernel: %s\n\n", Scanner::path());
+    std::printf("%10s %10s %10s %10s %14s\n", "bytes", "scalar", "sse2", "avx2", "compile+run");
+
+    AsulFormatString afs;
+    afs.setFormatCacheCapacity(0); // every call compiles the template again
+    for (size_t size : {size_t(4) << 10, size_t(64) << 10, size_t(1) << 20}) {
+        std::string text = makeTemplate(size);
+        std::printf("%10zu %7.2f GB/s", text.size(), kernelGBs(Scanner::scalar, text));
+#ifdef ASUL_FORMAT_STRING_SSE2
+        std::printf(" %5.2f GB/s", kernelGBs(Scanner::sse2, text));
+#else
+        std::printf(" %10s", "-");
+#endif
+#ifdef ASUL_FORMAT_STRING_AVX2
+        if (__builtin_cpu_supports("avx2")) std::printf(" %5.2f GB/s", kernelGBs(Scanner::avx2, text));
+        else std::printf(" %10s", "-");
+#else
+        std::printf(" %10s", "-");
+#endif
+        double ns = benchNsPerOp([&] { benchKeep(afs.f(text, 1, 2.5, "x").size()); });
+        std::printf(" %9.2f GB/s\n", static_cast<double>(text.size()) / ns);
+    }
+    return 0;
+}
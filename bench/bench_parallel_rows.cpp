@@ -0,0 +1,53 @@
+/*
+ * print_rows() throughput from 1 to N formatting threads (TableOptions::threads) on a
+ * 2M row, 3 column export, output in input order. The calling thread writes every block
+ * to the sink, here a copy into scratch memory, so that copy is the serial part.
+ *
+ *   g++ -std=c++17 -O2 -pthread -I.. bench_parallel_rows.cpp -o bench_parallel_rows
+ *   bench_parallel_rows [max threads, default: hardware threads]
+ */
+#include <cstdlib>
+#include "../AsulFormatString.h"
+#include "bench_common.h"
+
+int main(int argc, char **argv) {
+    const size_t rowCount = 2000000;
+    std::vector<std::tuple<std::string, uint64_t, double> > rows(rowCount);
+    for (size_t i = 0; i < rowCount; ++i) {
+        rows[i] = std::make_tuple("host-" + std::to_string(i * 7919 % 100000), i * i % 1000003, static_cast<double>(i % 1000) / 7.0);
+    }
+    const char *tmpl = "[[LEFT]][[SETW:20]]{}[[RIGHT]][[SETW:12]]{}[[FIXED]][[PREC:2]][[SETW:10]]{}[[ENDL]]";
+    const char *autoTmpl = "[[LEFT]]{} [[RIGHT]]{} [[FIXED]][[PREC:2]]{}[[ENDL]]";
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    if (argc > 1) cores = std::max(1, std::atoi(argv[1]));
+    std::vector<unsigned> counts;
+    for (unsigned t = 1; t < cores; t *= 2) counts.push_back(t);
+    counts.push_back(cores);
+
+    static ScratchSink sink;
+    std::printf("%u hardware threads\n", std::thread::hardware_concurrency());
+    std::printf("%-8s %16s %9s %22s %9s\n", "threads", "rows/s", "speedup", "rows/s (auto widths)", "speedup");
+    double base = 0, baseAuto = 0;
+    for (unsigned t : counts) {
+        AsulFormatString::TableOptions options;
+        options.threads = t;
+        auto rate = [&](const char *fmt) {
+            double best = 0;
+            for (int rep = 0; rep < 3; ++rep) {
+                auto t0 = std::chrono::steady_clock::now();
+                print_rows(sink, fmt, rows, options);
+                double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+                best = rep == 0 ? s : std::min(best, s);
+            }
+            return static_cast<double>(rowCount) / best;
+        };
+        double plain = rate(tmpl);
+        options.autoWidth = true;
+        double autoWidth = rate(autoTmpl);
+        if (t == 1) { base = plain; baseAuto = autoWidth; }
+        std::printf("%-8u %16.0f %8.2fx %22.0f %8.2fx\n", t, plain, plain / base, autoWidth, autoWidth / baseAuto);
+    }
+    benchKeep(sink.bytes);
+    return 0;
+}
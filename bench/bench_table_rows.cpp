@@ -0,0 +1,66 @@
+/*
+ * Rows per second for a 3 column report: one print() call per row (the way reports are
+ * written today) against print_rows() with the same template, with and without auto
+ * widths, row and column oriented. Output is discarded after a copy, so formatting and
+ * buffering is what is measured; the float column's to_chars is about a third of a row.
+ *
+ *   g++ -std=c++17 -O2 -I.. bench_table_rows.cpp -o bench_table_rows
+ */
+#include "../AsulFormatString.h"
+#include "bench_common.h"
+#include <functional>
+
+// std::cout target that drops everything, so print() keeps its normal path
+class NullBuf : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char *, std::streamsize n) override { return n; }
+};
+
+int main() {
+    const size_t rowCount = 500000;
+    std::vector<std::string> names(rowCount);
+    std::vector<uint64_t> counts(rowCount);
+    std::vector<double> ratios(rowCount);
+    std::vector<std::tuple<std::string, uint64_t, double> > rows(rowCount);
+    for (size_t i = 0; i < rowCount; ++i) {
+        names[i] = "host-" + std::to_string(i * 7919 % 100000);
+        counts[i] = i * i % 1000003;
+        ratios[i] = static_cast<double>(i % 1000) / 7.0;
+        rows[i] = std::make_tuple(names[i], counts[i], ratios[i]);
+    }
+    const char *tmpl = "[[LEFT]][[SETW:20]]{}[[RIGHT]][[SETW:12]]{}[[FIXED]][[PREC:2]][[SETW:10]]{}[[ENDL]]";
+    const char *autoTmpl = "[[LEFT]]{} [[RIGHT]]{} [[FIXED]][[PREC:2]]{}[[ENDL]]";
+    AsulFormatString::TableOptions autoWidth;
+    autoWidth.autoWidth = true;
+
+    NullBuf nullBuf;
+    std::streambuf *coutBuf = std::cout.rdbuf(&nullBuf);
+    static ScratchSink sink;
+    struct Case { const char *name; std::function<void()> run; };
+    const Case cases[] = {
+        {"print() per row, std::cout", [&] { for (const auto &r : rows) print(tmpl, std::get<0>(r), std::get<1>(r), std::get<2>(r)); }},
+        {"print(sink) per row", [&] { for (const auto &r : rows) print(sink, tmpl, std::get<0>(r), std::get<1>(r), std::get<2>(r)); }},
+        {"print_rows(), std::cout", [&] { print_rows(tmpl, rows); }},
+        {"print_rows(sink)", [&] { print_rows(sink, tmpl, rows); }},
+        {"print_rows(sink, columns)", [&] { print_rows(sink, tmpl, AsulFormatString::columns(names, counts, ratios)); }},
+        {"print_rows(sink), auto widths", [&] { print_rows(sink, autoTmpl, rows, autoWidth); }},
+    };
+    std::vector<std::pair<const char *, double> > results;
+    for (const Case &c : cases) {
+        double best = 0;
+        for (int rep = 0; rep < 3; ++rep) {
+            auto t0 = std::chrono::steady_clock::now();
+            c.run();
+            double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            best = rep == 0 ? s : std::min(best, s);
+        }
+        results.emplace_back(c.name, static_cast<double>(rowCount) / best);
+    }
+    std::cout.rdbuf(coutBuf);
+    benchKeep(sink.bytes);
+
+    std::printf("%-32s %14s %9s\n", "variant", "rows/s", "speedup");
+    for (const auto &r : results) std::printf("%-32s %14.0f %8.1fx\n", r.first, r.second, r.second / results[0].second);
+    return 0;
+}
@@ -0,0 +1,53 @@
+/*
+ * Throughput from 1 to N threads formatting against one instance. The concurrent
+ * reader/writer stress run is tests/thread_stress_test.cpp.
+ *
+ *   g++ -std=c++17 -O2 -pthread -I.. bench_thread_scaling.cpp -o bench_thread_scaling
+ */
+#include "../AsulFormatString.h"
+#include "bench_common.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+static void scaling(size_t maxThreads) {
+    AsulFormatString afs;
+    afs.installColorFormatAdapter();
+    afs.installLogLabelAdapter();
+    std::printf("%8s %14s %12s\n", "threads", "Mlines/s", "ns/line");
+    double single = 0;
+    for (size_t n = 1; n <= maxThreads; n *= 2) {
+        std::atomic<bool> go{false};
+        std::vector<double> nsPerLine(n);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < n; ++t) {
+            threads.emplace_back([&, t] {
+                while (!go.load()) std::this_thread::yield();
+                std::string line;
+                line.reserve(256);
+                int i = 0;
+                nsPerLine[t] = benchNsPerOp([&] {
+                    line.clear();
+                    ++i;
+                    afs.f_append(line, "(INFO) request {} took {GREEN} [[FIXED]][[PREC:2]]{} ms[[ENDL]]", i, "GET /", 0.25 * i);
+                    benchKeep(line.size());
+                });
+            });
+        }
+        go = true;
+        for (std::thread &th : threads) th.join();
+        double rate = 0;
+        for (double ns : nsPerLine) rate += 1e3 / ns;
+        if (n == 1) single = rate;
+        std::printf("%8zu %14.2f %12.1f   (x%.2f)\n", n, rate, 1e3 * n / rate, rate / single);
+        if (n < maxThreads && n * 2 > maxThreads) n = maxThreads / 2;
+    }
+}
+
+int main(int argc, char **argv) {
+    size_t hw = std::thread::hardware_concurrency();
+    size_t maxThreads = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : (hw ? hw : 4);
+    scaling(maxThreads);
+    return 0;
+}
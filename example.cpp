@@ -11,32 +11,6 @@
 #endif
 #include <vector>
 
-// UTF-8 码点切分辅助：返回每个码点的原始字节片段（保持原编码，不做宽字符转换）
-static std::vector<std::string> utf8_codepoints(const std::string &s) {
-    std::vector<std::string> cps;
-    for (size_t i = 0; i < s.size();) {
-        unsigned char c = static_cast<unsigned char>(s[i]);
-        size_t len = 1;
-        if ((c & 0x80) == 0x00) { // 0xxxxxxx ASCII
-            len = 1;
-        } else if ((c & 0xE0) == 0xC0 && i + 1 < s.size()) { // 110xxxxx 两字节
-            len = 2;
-        } else if ((c & 0xF0) == 0xE0 && i + 2 < s.size()) { // 1110xxxx 三字节
-            len = 3;
-        } else if ((c & 0xF8) == 0xF0 && i + 3 < s.size()) { // 11110xxx 四字节
-            len = 4;
-        } else {
-            // 非法或截断，按单字节回退，避免越界
-            len = 1;
-        }
-        cps.emplace_back(s.substr(i, len));
-        i += len;
-    }
-    return cps;
-}
-
-
-
 struct PrintStruct {
     int a;
     double b;
@@ -45,35 +19,21 @@ struct PrintStruct {
         return "{a=" + std::to_string(a) + ", b=" + std::to_string(b) + ", c=" + c + "}";
     }
 };
-// 按码点着色，避免中文被拆分
+// 按码点着色，避免中文被拆分；Color256::gradient 只在颜色变化处输出转义序列
 std::string stringWithRanbowColor(std::string src,double frequency=0.3){
-    auto cps = utf8_codepoints(src);
-    std::string result;
-    for(size_t i=0;i<cps.size();++i){
-        // 使用码点序号 i 生成颜色，确保一个中文字符整体使用同一颜色
-        unsigned char r = static_cast<unsigned char>((std::sin(frequency * i + 0) + 1) * 127.5);
-        unsigned char g = static_cast<unsigned char>((std::sin(frequency * i + 2) + 1) * 127.5);
-        unsigned char b = static_cast<unsigned char>((std::sin(frequency * i + 4) + 1) * 127.5);
-        result += Color256::rgba(r, g, b, 1).toANSI256() + cps[i];
-    }
-    result += "\033[0m";
-    return result;
+    return Color256::gradient(src, [&](size_t i) {
+        return Color256::rgba(static_cast<unsigned char>((std::sin(frequency * i + 0) + 1) * 127.5),
+                              static_cast<unsigned char>((std::sin(frequency * i + 2) + 1) * 127.5),
+                              static_cast<unsigned char>((std::sin(frequency * i + 4) + 1) * 127.5), 1);
+    });
 }
 std::string stringWithRanbowColorFrame(std::string src,int frame,double frequency=0.3){
-    auto cps = utf8_codepoints(src);
-    std::string result;
-    for(size_t i=0;i<cps.size();++i){
-        if(cps[i]==" ") { // 保持空格不着色
-            result += cps[i];
-            continue;
-        }
-        unsigned char r = static_cast<unsigned char>((std::sin(frequency * i + frame * 0.3 + 0) + 1) * 127.5);
-        unsigned char g = static_cast<unsigned char>((std::sin(frequency * i + frame * 0.3 + 2) + 1) * 127.5);
-        unsigned char b = static_cast<unsigned char>((std::sin(frequency * i + frame * 0.3 + 4) + 1) * 127.5);
-        result += Color256::rgba(r, g, b, 1).toANSI256() + cps[i];
-    }
-    result += "\033[0m";
-    return result;
+    // 空格没有字形，前景色对它不可见，因此不必单独跳过
+    return Color256::gradient(src, [&](size_t i) {
+        return Color256::rgba(static_cast<unsigned char>((std::sin(frequency * i + frame * 0.3 + 0) + 1) * 127.5),
+                              static_cast<unsigned char>((std::sin(frequency * i + frame * 0.3 + 2) + 1) * 127.5),
+                              static_cast<unsigned char>((std::sin(frequency * i + frame * 0.3 + 4) + 1) * 127.5), 1);
+    });
 }
 int main(int argc,char *argv[]){
 
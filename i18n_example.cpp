@@ -11,21 +11,11 @@ struct RainbowArgs {
     int index;
 };
 std::string stringWithRanbowColorFrame(RainbowArgs args){
-    std::string result;
-    size_t len=args.text.length();
-    for(size_t i=0;i<len;++i){
-        if(args.text[i]==' ') {
-            result += args.text[i];
-            continue;
-        }
-        unsigned char r = static_cast<unsigned char>((std::sin(0.3 * i + args.index * 0.3 + 0) + 1) * 127.5);
-        unsigned char g = static_cast<unsigned char>((std::sin(0.3 * i + args.index * 0.3 + 2) + 1) * 127.5);
-        unsigned char b = static_cast<unsigned char>((std::sin(0.3 * i + args.index * 0.3 + 4) + 1) * 127.5);
-        result += Color256::rgba(r, g, b, 1).toANSI256() + args.text[i];
-    }
-    result += "\033[0m";
-    return result;
-
+    return Color256::gradient(args.text, [&](size_t i) {
+        return Color256::rgba(static_cast<unsigned char>((std::sin(0.3 * i + args.index * 0.3 + 0) + 1) * 127.5),
+                              static_cast<unsigned char>((std::sin(0.3 * i + args.index * 0.3 + 2) + 1) * 127.5),
+                              static_cast<unsigned char>((std::sin(0.3 * i + args.index * 0.3 + 4) + 1) * 127.5), 1);
+    });
 }
 
 int main(int argc,char *argv[]){
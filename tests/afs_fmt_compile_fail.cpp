@@ -0,0 +1,30 @@
+/*
+ * AFS_FMT literals that must be rejected at compile time, one per AFS_FMT_FAIL_<case>
+ * define. tests/CMakeLists.txt builds each case and expects the build to fail with the
+ * static_assert message for it; AFS_FMT_FAIL_none must build.
+ *
+ *   g++ -std=c++17 -fsyntax-only -DAFS_FMT_FAIL_parentheses -I.. afs_fmt_compile_fail.cpp
+ */
+#include "../AsulFormatString.h"
+
+int main() {
+#if defined(AFS_FMT_FAIL_parentheses)
+    return static_cast<int>(f(AFS_FMT("(unclosed {}"), 1).size());
+#elif defined(AFS_FMT_FAIL_curly)
+    return static_cast<int>(f(AFS_FMT("unclosed { {}"), 1).size());
+#elif defined(AFS_FMT_FAIL_square)
+    return static_cast<int>(f(AFS_FMT("stray ]] {}"), 1).size());
+#elif defined(AFS_FMT_FAIL_empty)
+    return static_cast<int>(f(AFS_FMT("[[]]{}"), 1).size());
+#elif defined(AFS_FMT_FAIL_unknown)
+    return static_cast<int>(f(AFS_FMT("[[NOPE]]{}"), 1).size());
+#elif defined(AFS_FMT_FAIL_value)
+    return static_cast<int>(f(AFS_FMT("[[SETW:x]]{}"), 1).size());
+#elif defined(AFS_FMT_FAIL_few)
+    return static_cast<int>(f(AFS_FMT("{} {}"), 1).size());
+#elif defined(AFS_FMT_FAIL_many)
+    return static_cast<int>(f(AFS_FMT("{}"), 1, 2).size());
+#else
+    return static_cast<int>(f(AFS_FMT("(fine) {} [[SETW:4]]{}"), 1, 2).size());
+#endif
+}
@@ -0,0 +1,69 @@
+/*
+ * AFS_FMT literals against the same text as a runtime format: f(), f_to_n(), print() into
+ * a sink and try_f() must give the same output, for static formats (directives, escapes,
+ * [[ENDL]], {} inside [[...]]) and for dynamic ones that reference labels, format and func
+ * adapters, also after the adapters change. afs_fmt_compile_fail.cpp holds the literals
+ * that must not compile; tests/CMakeLists.txt checks each fails with its static_assert.
+ *
+ *   g++ -std=c++17 -O2 -pthread -I.. afs_fmt_test.cpp -o afs_fmt_test
+ */
+#include "../AsulFormatString.h"
+#include "test_common.h"
+#include <vector>
+
+// fmt twice: as an AFS_FMT literal and as a runtime string
+#define SAME(afs, literal, ...) same(afs, #literal, AFS_FMT(literal), literal, __VA_ARGS__)
+
+template <typename Fmt, typename... Args>
+static void same(AsulFormatString &afs, const char *what, Fmt fmt, std::string_view text, const Args&... args) {
+    std::string runtime = afs.f(text, args...);
+    expect(std::string(what) + ": f()", afs.f(fmt, args...), runtime);
+
+    char buf[16];
+    AsulFormatString::FormatToNResult n = afs.f_to_n(buf, sizeof buf, fmt, args...);
+    expect(std::string(what) + ": f_to_n() needed", n.needed, runtime.size());
+    expect(std::string(what) + ": f_to_n() text", std::string(buf, n.written), runtime.substr(0, sizeof buf));
+
+    std::string out = "> ";
+    AsulFormatString::StringSink sink(out);
+    afs.print(sink, fmt, args...);
+    expect(std::string(what) + ": print(sink)", out, "> " + runtime);
+
+    AsulFormatString::FormatResult r = afs.try_f(fmt, args...);
+    expect(std::string(what) + ": try_f()", r.value(), runtime);
+}
+
+int main() {
+    AsulFormatString afs;
+    SAME(afs, "plain text {}", 0);
+    SAME(afs, "{} + {} = {}", 1, 2, 3);
+    SAME(afs, "[[LEFT]][[SETW:8]]{}|[[RIGHT]][[SETW:6]]{}|", "left", 42);
+    SAME(afs, "[[FILL:*]][[SETW:7]]{}[[RESET]] {}", 3.5, 4);
+    SAME(afs, "[[FIXED]][[PREC:3]]{} [[SCIENTIFIC]]{}", 3.14159, 1234.5);
+    SAME(afs, "{{literal}} ((paren)) ] } {}", 1);
+    SAME(afs, "line {}[[ENDL]]next[[ENDL]]", 1);
+    SAME(afs, "[[SETW:{}]]{}|", 6, "ab");
+    SAME(afs, "[[JOIN: / ]]{}", std::vector<int>{1, 2, 3});
+    SAME(afs, "\xE4\xBD\xA0\xE5\xA5\xBD [[SETW:6]]{}|", "\xE5\xAD\x97");
+    SAME(afs, "\033[1m{}\033[0m", "bold");
+
+    // dynamic: adapters resolved at run time, through the same registry
+    afs.installColorFormatAdapter();
+    afs.installLabelAdapter({{"TAG", "[tag]"}});
+    afs.installFormatAdapter({{"PAIR", "<{}:{}>"}});
+    afs.installFuncFormatAdapter({{"TWICE", [](const AsulFormatString::VariantType &v) {
+        std::string s = AsulFormatString::variantToString(v);
+        return s + s;
+    }}});
+    SAME(afs, "(TAG) {PAIR} {TWICE} {RED}", 1, 2, "ab", "red");
+    SAME(afs, "(UNKNOWN) {NOPE} {}", 1);
+    SAME(afs, "[[SETW:8]]{RED}|", "x");
+    afs.installLabelAdapter({{"TAG", "[changed]"}});
+    SAME(afs, "(TAG) {PAIR} {TWICE} {RED}", 1, 2, "ab", "red");
+    afs.freeze();
+    SAME(afs, "(TAG) {PAIR} {TWICE} {RED}", 1, 2, "ab", "red");
+
+    // the global f() takes AFS_FMT too
+    expect("global f()", f(AFS_FMT("{}-{}"), 1, 2), "1-2");
+    return testResult();
+}
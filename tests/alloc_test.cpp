@@ -0,0 +1,73 @@
+/*
+ * Heap allocations of warm print(sink, ...) calls: argument capture borrows the arguments
+ * on the stack and the compiled format comes from the per-thread cache, so once a format
+ * has been seen, printing std::string / int / const char* arguments into a caller's sink
+ * must not allocate.
+ *
+ *   g++ -std=c++17 -O2 -pthread -I.. alloc_test.cpp -o alloc_test
+ */
+#include "../AsulFormatString.h"
+#include "test_common.h"
+#include <cstdlib>
+#include <new>
+
+// GCC pairs the inlined malloc/free of these replacements with new/delete expressions
+// and warns wrongly
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+static size_t allocCount = 0;
+static bool allocCounting = false;
+void *operator new(size_t size) {
+    if (allocCounting) ++allocCount;
+    if (void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+
+// Keeps the bytes in a fixed buffer, the way a caller provided sink would
+class ArraySink : public AsulFormatString::Sink {
+public:
+    using Sink::write;
+    void write(const char *data, size_t size) override {
+        for (size_t i = 0; i < size && used < sizeof buf; ++i) buf[used++] = data[i];
+    }
+    std::string_view text() const { return std::string_view(buf, used); }
+    size_t used = 0;
+private:
+    char buf[256];
+};
+
+// Runs call once to warm the caches, then counts the allocations of the second run and
+// checks its output
+template <typename Fn>
+static void expectNoAllocations(const char *name, std::string_view expected, Fn &&call) {
+    ArraySink warm;
+    call(warm);
+    ArraySink sink;
+    allocCount = 0;
+    allocCounting = true;
+    call(sink);
+    allocCounting = false;
+    expect(std::string(name) + ": allocations", allocCount, size_t(0));
+    expect(std::string(name) + ": output", sink.text(), expected);
+}
+
+int main() {
+    // longer than any small string buffer, so a copy would have to allocate
+    const std::string name = "a-service-name-well-past-the-small-string-limit";
+    const std::string other = "another-string-argument-past-the-small-string-limit";
+    expectNoAllocations("print(sink, \"{} {}\", std::string, int)", name + " 42",
+                        [&](ArraySink &s) { print(s, "{} {}", name, 42); });
+    expectNoAllocations("print(sink, \"{} {}\", std::string, std::string)", name + " " + other,
+                        [&](ArraySink &s) { print(s, "{} {}", name, other); });
+    expectNoAllocations("print(sink, \"{}={}\", const char*, double)", "ratio=0.25",
+                        [&](ArraySink &s) { print(s, "{}={}", "ratio", 0.25); });
+    expectNoAllocations("print(sink, \"[[SETW:6]]{}|\", int)", "    42|",
+                        [&](ArraySink &s) { print(s, "[[SETW:6]]{}|", 42); });
+    return testResult();
+}
@@ -0,0 +1,142 @@
+/*
+ * AsulAsyncSink with several producers and a slow target under each overflow policy:
+ * every producer's records arrive in the order it wrote them, flush() returns only once
+ * every record accepted before it is in the target, and records written plus dropped()
+ * add up to the records produced. A DropOldest flush() must also wait for the batch the
+ * writer thread is still writing, however many newer records are dropped meanwhile. Most
+ * useful in a -fsanitize=thread build (AFS_TSAN=ON).
+ *
+ *   g++ -std=c++17 -O2 -pthread -I.. async_sink_test.cpp -o async_sink_test
+ */
+#include "../AsulAsync.h"
+#include "test_common.h"
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Collects "producer:sequence" records, slowly enough for the ring to fill up
+class SlowSink : public AsulFormatString::Sink {
+public:
+    using AsulFormatString::Sink::write;
+    void write(const char *data, size_t size) override {
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+        std::lock_guard<std::mutex> lock(mutex);
+        text.append(data, size);
+    }
+    std::string contents() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return text;
+    }
+private:
+    std::mutex mutex;
+    std::string text;
+};
+
+// Holds the writer thread inside write() until opened
+class GateSink : public AsulFormatString::Sink {
+public:
+    using AsulFormatString::Sink::write;
+    void write(const char *data, size_t size) override {
+        std::unique_lock<std::mutex> lock(mutex);
+        entered = true;
+        changed.notify_all();
+        changed.wait(lock, [&] { return open; });
+        text.append(data, size);
+    }
+    void waitEntered() {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return entered; });
+    }
+    void release() {
+        std::lock_guard<std::mutex> lock(mutex);
+        open = true;
+        changed.notify_all();
+    }
+    std::string contents() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return text;
+    }
+private:
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool entered = false, open = false;
+    std::string text;
+};
+
+static size_t lineCount(const std::string &s) {
+    return static_cast<size_t>(std::count(s.begin(), s.end(), '\n'));
+}
+
+static void run(const char *name, AsulAsyncSink::Overflow policy) {
+    const size_t producers = 4, records = 3000;
+    SlowSink target;
+    AsulAsyncSink async(target, 16, policy);
+    std::atomic<size_t> written{0}, shortFlushes{0};
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            char line[32];
+            for (size_t i = 0; i < records; ++i) {
+                int len = std::snprintf(line, sizeof line, "%zu:%zu\n", p, i);
+                async.write(line, static_cast<size_t>(len));
+                ++written;
+                if (i % 256 == 255) {
+                    // every record written before the flush is in the target or was dropped
+                    size_t before = written.load();
+                    async.flush();
+                    if (lineCount(target.contents()) + async.dropped() < before) ++shortFlushes;
+                }
+            }
+        });
+    }
+    for (std::thread &th : threads) th.join();
+    async.flush();
+
+    std::string out = target.contents();
+    std::string what(name);
+    expect(what + ": flush() returned before its records were written", shortFlushes.load(), size_t(0));
+    expect(what + ": written + dropped", lineCount(out) + async.dropped(), producers * records);
+    if (policy == AsulAsyncSink::Overflow::Block) expect(what + ": nothing dropped", async.dropped(), size_t(0));
+
+    std::vector<long> last(producers, -1);
+    size_t outOfOrder = 0;
+    for (size_t pos = 0; pos < out.size(); ) {
+        size_t end = out.find('\n', pos);
+        size_t p = std::stoul(out.substr(pos, end - pos));
+        long i = std::stol(out.substr(out.find(':', pos) + 1, end - pos));
+        if (p >= producers || i <= last[p]) ++outOfOrder;
+        else last[p] = i;
+        pos = end + 1;
+    }
+    expect(what + ": records out of producer order", outOfOrder, size_t(0));
+}
+
+static void flushWaitsForBatchInFlight() {
+    GateSink target;
+    AsulAsyncSink async(target, 16, AsulAsyncSink::Overflow::DropOldest);
+    async.write("first\n");
+    target.waitEntered(); // "first" is the writer's batch, held in the target
+    for (int i = 0; i < 16; ++i) async.write("queued\n");
+    std::atomic<bool> flushed{false};
+    std::thread flusher([&] {
+        async.flush();
+        flushed = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    // drops everything queued before the flush and as many newer records again
+    for (int i = 0; i < 64; ++i) async.write("newer\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    expect("DropOldest flush() waits for the batch in flight", flushed.load(), false);
+    target.release();
+    flusher.join();
+    expect("batch in flight written", target.contents().compare(0, 6, "first\n"), 0);
+}
+
+int main() {
+    flushWaitsForBatchInFlight();
+    run("Block", AsulAsyncSink::Overflow::Block);
+    run("DropNewest", AsulAsyncSink::Overflow::DropNewest);
+    run("DropOldest", AsulAsyncSink::Overflow::DropOldest);
+    return testResult();
+}
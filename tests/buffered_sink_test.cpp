@@ -0,0 +1,51 @@
+/*
+ * BufferedFdSink's timeThreshold flushes on its own: bytes written before a quiet period
+ * reach the fd once they are older than the threshold, with no further write, flush() or
+ * destruction. POSIX only (a pipe stands in for the fd).
+ *
+ *   g++ -std=c++17 -O2 -pthread -I.. buffered_sink_test.cpp -o buffered_sink_test
+ */
+#include "../AsulFormatString.h"
+#include "test_common.h"
+#include <poll.h>
+
+// Up to want bytes read from fd within timeoutMs
+static std::string readWithin(int fd, size_t want, int timeoutMs) {
+    std::string got;
+    pollfd p{fd, POLLIN, 0};
+    auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (got.size() < want && std::chrono::steady_clock::now() < until) {
+        int left = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(until - std::chrono::steady_clock::now()).count());
+        if (::poll(&p, 1, left > 0 ? left : 0) <= 0) break;
+        char buf[256];
+        ssize_t n = ::read(fd, buf, sizeof buf);
+        if (n <= 0) break;
+        got.append(buf, static_cast<size_t>(n));
+    }
+    return got;
+}
+
+int main() {
+    int fds[2];
+    if (::pipe(fds) != 0) return 1;
+    AsulFormatString::BufferedFdSink::FlushPolicy timed = AsulFormatString::BufferedFdSink::explicitFlush();
+    timed.timeThreshold = std::chrono::milliseconds(20);
+    {
+        AsulFormatString::BufferedFdSink sink(fds[1], timed);
+        print(sink, "first {}[[ENDL]]", 1);
+        print(sink, "second {}[[ENDL]]", 2);
+        expect("buffered lines flushed after a quiet period", readWithin(fds[0], 17, 1000), "first 1\nsecond 2\n");
+        print(sink, "third {}[[ENDL]]", 3);
+        expect("flusher keeps running for later writes", readWithin(fds[0], 8, 1000), "third 3\n");
+    }
+    {
+        AsulFormatString::BufferedFdSink sink(fds[1], AsulFormatString::BufferedFdSink::explicitFlush());
+        print(sink, "held[[ENDL]]");
+        expect("no time threshold: nothing written before flush()", readWithin(fds[0], 1, 100), "");
+        sink.flush();
+        expect("flush() writes", readWithin(fds[0], 5, 1000), "held\n");
+    }
+    ::close(fds[0]);
+    ::close(fds[1]);
+    return testResult();
+}
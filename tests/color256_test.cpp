@@ -0,0 +1,20 @@
+/*
+ * Color256 channels above 255 (the constexpr constructor keeps them) are clamped the same
+ * way by toIndex256, the truecolor escapes and gradient.
+ *
+ *   g++ -std=c++17 -O2 -I.. color256_test.cpp -o color256_test
+ */
+#include "../Color256.h"
+#include "test_common.h"
+
+int main() {
+    constexpr Color256 over(300, 1000, 256), white(255, 255, 255);
+    static_assert(over.toIndex256() == white.toIndex256(), "toIndex256 clamps");
+    expect("toANSITrueColor", over.toANSITrueColor(), "\033[38;2;255;255;255m");
+    expect("toANSITrueColorBackground", over.toANSITrueColorBackground(), "\033[48;2;255;255;255m");
+    expect("toANSI256", over.toANSI256(), white.toANSI256());
+    auto overAt = [&](size_t) { return over; };
+    expect("gradient, truecolor", Color256::gradient("ab", overAt, true), "\033[38;2;255;255;255mab\033[0m");
+    expect("gradient, 256 colors", Color256::gradient("ab", overAt), white.toANSI256() + "ab\033[0m");
+    return testResult();
+}
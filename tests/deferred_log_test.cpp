@@ -0,0 +1,71 @@
+/*
+ * AsulDeferredLogger records against f() on the same arguments: ints, floats, enums,
+ * strings and string_views carried as bytes and decoded on the writer thread, a struct
+ * opted in with AsulDeferredRaw, and a struct holding a string_view, which must be
+ * formatted on the calling thread because the text it points to is gone by the time the
+ * writer runs.
+ *
+ *   g++ -std=c++17 -O2 -pthread -I.. deferred_log_test.cpp -o deferred_log_test
+ */
+#include "../AsulAsync.h"
+#include "test_common.h"
+#include <cstring>
+#include <vector>
+
+enum class Level { Info = 1, Warn = 2 };
+std::ostream &operator<<(std::ostream &os, Level l) { return os << (l == Level::Info ? "info" : "warn"); }
+
+struct Sample { int id; double value; };
+std::ostream &operator<<(std::ostream &os, const Sample &s) { return os << s.id << '=' << s.value; }
+template <>
+struct AsulDeferredRaw<Sample> : std::true_type {};
+
+struct Tagged { std::string_view tag; int n; };
+std::ostream &operator<<(std::ostream &os, const Tagged &t) { return os << t.tag << '#' << t.n; }
+
+int main() {
+    AsulFormatString afs;
+    std::string out;
+    std::vector<std::string> expected;
+    AsulFormatString::StringSink sink(out);
+    {
+        AsulDeferredLogger log(sink, afs);
+        auto both = [&](const char *fmt, const auto&... args) {
+            log.log(fmt, args...);
+            expected.push_back(afs.f(fmt, args...));
+        };
+        std::string name = "request-4711";
+        std::string_view view = std::string_view(name).substr(8);
+        const char *cstr = "c string";
+        both("{} {} {}\n", 42, -7LL, 18446744073709551615ULL);
+        both("{} {} [[PREC:3]]{}\n", 0.25f, 1e-300, 3.14159);
+        both("{} {} {} {}\n", name, view, cstr, std::string());
+        both("{} {} {}\n", true, 'x', Level::Warn);
+        both("{}\n", Sample{3, 0.5});
+        both("{}\n", AsulDeferredLogger::literal("literal"));
+
+        // the view dies right after the call; the record must not keep pointing at it
+        char scratch[16];
+        std::strcpy(scratch, "before");
+        log.log("{}\n", Tagged{std::string_view(scratch), 1});
+        expected.push_back("before#1\n");
+        std::strcpy(scratch, "AFTER!");
+
+        const std::string big = std::string(3000, 'z') + "end";
+        both("{}|{}\n", big, std::string_view(big).substr(2995));
+
+        log.log(AFS_FMT("static {} {} {}\n"), 1, 2.5, name);
+        expected.push_back(afs.f(AFS_FMT("static {} {} {}\n"), 1, 2.5, name));
+        log.flush();
+    }
+    std::vector<std::string> records;
+    for (size_t pos = 0, end; pos < out.size(); pos = end + 1) {
+        end = out.find('\n', pos);
+        if (end == std::string::npos) end = out.size() - 1;
+        records.push_back(out.substr(pos, end + 1 - pos));
+    }
+    expect("record count", records.size(), expected.size());
+    for (size_t i = 0; i < expected.size() && i < records.size(); ++i)
+        expect("record " + std::to_string(i), records[i], expected[i]);
+    return testResult();
+}
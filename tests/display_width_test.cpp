@@ -0,0 +1,48 @@
+/*
+ * SETW / LEFT / RIGHT padding in terminal columns: DisplayWidth on ASCII, escapes, CJK,
+ * emoji, combining marks and invalid UTF-8, a SETW carried over the escape of a color
+ * adapter, funcAdapter output and print_rows auto widths.
+ *
+ *   g++ -std=c++17 -O2 -pthread -I.. display_width_test.cpp -o display_width_test
+ */
+#include "../AsulFormatString.h"
+#include "test_common.h"
+#include <tuple>
+#include <vector>
+
+int main() {
+    using DW = AsulFormatString::DisplayWidth;
+    expect("ascii", DW::of("hello"), 5);
+    expect("ascii past one SSE2 block", DW::of(std::string(40, 'a') + "\xE4\xB8\xAD" + std::string(20, 'b')), 62);
+    expect("CSI escapes", DW::of("\033[38;5;196mred\033[0m"), 3);
+    expect("OSC title", DW::of("\033]0;title\a"), 0);
+    expect("CJK", DW::of("\xE4\xB8\xAD\xE6\x96\x87"), 4);
+    expect("Hangul", DW::of("\xED\x95\x9C\xEA\xB5\xAD\xEC\x96\xB4 ok"), 9);
+    expect("emoji", DW::of("\xF0\x9F\x98\x80"), 2);
+    expect("combining acute", DW::of("e\xCC\x81"), 1);
+    expect("invalid bytes", DW::of("\xFF\xFE"), 2);
+    // 0xF5..0xFF never lead a sequence: one column per byte, continuation bytes included
+    expect("0xF8 lead", DW::of("\xF8\x80\x80"), 3);
+    expect("0xFF lead", DW::of("\xFF\x80\x80\x80"), 4);
+    expect("0xF5 lead", DW::of("a\xF5\x80\x80\x80" "b"), 6);
+
+    AsulFormatString afs;
+    afs.installColorFormatAdapter();
+    afs.installTypedFuncAdapter<int>("twice", [](int v) { return std::to_string(v * 2); });
+    std::string red = afs.f("{RED}", "x");
+    std::string open = red.substr(0, red.find('x')), close = red.substr(red.find('x') + 1);
+    expect("CJK argument", afs.f(std::string_view("[[SETW:8]]{}|"), "\xE4\xB8\xAD\xE6\x96\x87"), "    \xE4\xB8\xAD\xE6\x96\x87|");
+    expect("colored argument", afs.f(std::string_view("[[LEFT]][[SETW:6]]{}|"), red), red + "     |");
+    expect("SETW before a color adapter", afs.f(std::string_view("[[SETW:6]]{RED}|"), "ab"), open + "    ab" + close + "|");
+    expect("SETW ended by plain text", afs.f(std::string_view("[[SETW:4]]ab{}|"), 7), "ab7|");
+    expect("funcAdapter output", afs.f(std::string_view("[[SETW:6]]{twice}|"), 42), "    84|");
+
+    std::vector<std::tuple<std::string, int> > rows{{"\xE5\x90\x8D\xE5\x89\x8D", 1}, {"abc", 22}};
+    AsulFormatString::TableOptions options;
+    options.autoWidth = true;
+    std::string table;
+    AsulFormatString::StringSink sink(table);
+    afs.print_rows(sink, "{}|{}\n", rows, options);
+    expect("print_rows auto widths", table, "\xE5\x90\x8D\xE5\x89\x8D| 1\n abc|22\n");
+    return testResult();
+}
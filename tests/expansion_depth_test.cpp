@@ -0,0 +1,77 @@
+/*
+ * Adapter expansion depth: self-referential and mutually recursive format and label
+ * adapters stop at ExpansionStack::maxDepth (32) with a FormatIssue::Adapter pointing at
+ * the outermost reference, thrown by f() and returned by try_f(), also inside a [[...]]
+ * token. A legitimate chain of 31 or 32 nested adapters still expands, 33 does not.
+ *
+ *   g++ -std=c++17 -O2 -pthread -I.. expansion_depth_test.cpp -o expansion_depth_test
+ */
+#include "../AsulFormatString.h"
+#include "test_common.h"
+
+using Issue = AsulFormatString::FormatIssue;
+
+static void expectTooDeep(AsulFormatString &afs, const std::string &fmt, size_t offset) {
+    auto r = afs.try_f(fmt, 1);
+    expect(fmt + ": try_f code", r.error().code, Issue::Adapter);
+    expect(fmt + ": try_f offset", r.error().offset, offset);
+    expect(fmt + ": try_f text", r.value(), "");
+    expect(fmt + ": message names the depth", r.error().message.find("deeper than 32 levels") != std::string::npos, true);
+    Issue::Code thrown = Issue::None;
+    try {
+        afs.f(fmt, 1);
+    } catch (const AsulFormatString::FormatError &e) {
+        thrown = e.code();
+    }
+    expect(fmt + ": f() throws", thrown, Issue::Adapter);
+}
+
+// C0 -> C1 -> ... -> C<levels - 1> -> "end {}"
+static void installChain(AsulFormatString &afs, const std::string &prefix, size_t levels) {
+    AsulFormatString::AdapterMap chain;
+    for (size_t i = 0; i + 1 < levels; ++i) chain[prefix + std::to_string(i)] = "{" + prefix + std::to_string(i + 1) + "}";
+    chain[prefix + std::to_string(levels - 1)] = "end {}";
+    afs.installFormatAdapter(chain);
+}
+
+int main() {
+    AsulFormatString afs;
+    afs.installFormatAdapter({
+        {"SELF", "x{SELF}"},
+        {"PING", "<{PONG}>"},
+        {"PONG", "[{PING}]"},
+        {"TAIL", "{TAIL}"},
+    });
+    afs.installLabelAdapter({
+        {"LOOP", "(LOOP)!"},
+        {"A", "(B)"},
+        {"B", "(A)"},
+    });
+
+    expectTooDeep(afs, "{SELF}", 0);
+    expectTooDeep(afs, "ab {TAIL} {}", 3);
+    expectTooDeep(afs, "value {} {PING}", 9);
+    expectTooDeep(afs, "(LOOP) {}", 0);
+    expectTooDeep(afs, "{} (A)", 3);
+    expect("validate() reports it too", afs.validate("x (B)").code, Issue::Adapter);
+
+    // inside a [[...]] token, resolved while formatting
+    auto token = afs.try_f("[[SETW:{SELF}]]{}", 1);
+    expect("[[...]] token: code", token.error().code, Issue::Adapter);
+    expect("[[...]] token: offset", token.error().offset, size_t(0));
+
+    // the limit counts nested expansions, not references
+    installChain(afs, "C", 31);
+    expect("31 nested adapters", afs.f("{C0}", 7), "end 7");
+    expect("31 nested adapters, twice", afs.f("{C0} {C0}", 1, 2), "end 1 end 2");
+    installChain(afs, "D", 32);
+    expect("32 nested adapters", afs.f("{D0}", 7), "end 7");
+    installChain(afs, "E", 33);
+    expectTooDeep(afs, "{E0}", 0);
+
+    // a failure is cached like any compiled format and cleared with the adapter
+    expectTooDeep(afs, "{SELF}", 0);
+    afs.installFormatAdapter({{"SELF", "self"}});
+    expect("fixed adapter", afs.f("{SELF} {}", 1), "self 1");
+    return testResult();
+}
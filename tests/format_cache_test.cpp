@@ -0,0 +1,117 @@
+/*
+ * The per-thread compiled format cache: hits, misses and evictions of an LRU bounded by
+ * setFormatCacheCapacity, shrinking and disabling it, and install* after a format was
+ * cached changing what the next f() prints (the thread sees the new generation and drops
+ * its compiled formats). Two instances used alternately on one thread each keep their
+ * own cache, also when one formats from inside a funcAdapter of the other.
+ *
+ *   g++ -std=c++17 -O2 -pthread -I.. format_cache_test.cpp -o format_cache_test
+ */
+#include "../AsulFormatString.h"
+#include "test_common.h"
+
+using Stats = AsulFormatString::FormatCacheStats;
+
+// Counters moved since the last call; size and capacity as they are now
+static Stats delta(AsulFormatString &afs, Stats &last) {
+    Stats now = afs.formatCacheStats(), d = now;
+    d.hits -= last.hits;
+    d.misses -= last.misses;
+    d.evictions -= last.evictions;
+    d.invalidations -= last.invalidations;
+    last = now;
+    return d;
+}
+
+static void expectStats(const std::string &what, const Stats &d, size_t hits, size_t misses, size_t evictions, size_t size) {
+    expect(what + ": hits", d.hits, hits);
+    expect(what + ": misses", d.misses, misses);
+    expect(what + ": evictions", d.evictions, evictions);
+    expect(what + ": size", d.size, size);
+}
+
+int main() {
+    AsulFormatString afs;
+    const std::string fmts[] = {"a{}", "b{}", "c{}", "d{}", "e{}", "f{}"};
+    auto use = [&](int i) { return afs.f(fmts[i], i); };
+
+    afs.setFormatCacheCapacity(4);
+    Stats last = afs.formatCacheStats();
+    expect("capacity", last.capacity, size_t(4));
+
+    for (int i = 0; i < 6; ++i) use(i);
+    expectStats("six formats, capacity 4", delta(afs, last), 0, 6, 2, 4);
+
+    // cached, most recent first: f e d c
+    use(5);
+    use(4);
+    expectStats("two recent formats again", delta(afs, last), 2, 0, 0, 4);
+    expect("cached output", use(4), "e4");
+    delta(afs, last);
+
+    // e f d c -> a in, c (least recently used) out
+    use(0);
+    expectStats("evicted format again", delta(afs, last), 0, 1, 1, 4);
+    use(3); // d a e f
+    use(2); // c d a e, f out
+    expectStats("touch d, c back", delta(afs, last), 1, 1, 1, 4);
+    use(4);
+    use(5);
+    expectStats("e kept, f evicted", delta(afs, last), 1, 1, 1, 4);
+
+    afs.setFormatCacheCapacity(2);
+    expect("shrunk output", use(5), "f5");
+    Stats d = delta(afs, last);
+    expectStats("capacity 2", d, 1, 0, 2, 2);
+    expect("capacity 2: capacity", d.capacity, size_t(2));
+
+    afs.setFormatCacheCapacity(0);
+    use(5);
+    use(5);
+    expectStats("capacity 0", delta(afs, last), 0, 2, 2, 0);
+
+    // install* after a cached compile: the next f() sees the new adapters
+    afs.setFormatCacheCapacity(16);
+    afs.installFormatAdapter({{"WHO", "alice"}});
+    delta(afs, last);
+    expect("format adapter", afs.f("hi {WHO} {}", 1), "hi alice 1");
+    expect("format adapter cached", afs.f("hi {WHO} {}", 1), "hi alice 1");
+    d = delta(afs, last);
+    expectStats("format adapter", d, 1, 1, 0, 1);
+    expect("format adapter: invalidations", d.invalidations, size_t(0));
+
+    afs.installFormatAdapter({{"WHO", "bob"}});
+    expect("format adapter replaced", afs.f("hi {WHO} {}", 1), "hi bob 1");
+    d = delta(afs, last);
+    expectStats("format adapter replaced", d, 0, 1, 0, 1);
+    expect("format adapter replaced: invalidations", d.invalidations, size_t(1));
+
+    afs.installFuncFormatAdapter({{"WHO", [](const AsulFormatString::VariantType &v) {
+        return "#" + AsulFormatString::variantToString(v);
+    }}});
+    expect("func adapter over format adapter", afs.f("hi {WHO} {}", 1, 2), "hi #1 2");
+
+    expect("unknown name", afs.f("{UP}", "x"), "{UP}");
+    afs.installTypedFuncAdapter<std::string>("UP", [](const std::string &s) { return s + "!"; });
+    expect("func adapter installed after use", afs.f("{UP}", "x"), "x!");
+    afs.clearFuncFormatAdapter();
+    expect("func adapter cleared", afs.f("{UP}", "x"), "{UP}");
+
+    // a second instance on the same thread does not drop the first one's compiled formats
+    AsulFormatString other;
+    Stats otherLast = other.formatCacheStats();
+    delta(afs, last);
+    for (int i = 0; i < 100; ++i) {
+        afs.f("a{}", i);
+        other.f("a{}", i);
+    }
+    expectStats("alternating, first", delta(afs, last), 99, 1, 0, 2);
+    expectStats("alternating, second", delta(other, otherLast), 99, 1, 0, 1);
+
+    other.installTypedFuncAdapter<int>("NEST", [&](int v) { return afs.f("a{}", v); });
+    delta(other, otherLast);
+    for (int i = 0; i < 10; ++i) expect("nested", other.f("<{NEST}>", i), "<a" + std::to_string(i) + ">");
+    expectStats("nested, inner", delta(afs, last), 10, 0, 0, 2);
+    expectStats("nested, outer", delta(other, otherLast), 9, 1, 0, 1);
+    return testResult();
+}
@@ -0,0 +1,68 @@
+/*
+ * f_to_n truncation: for every buffer size from 0 to past the full length, needed is the
+ * full length, written is min(n, needed), truncated() says whether it was cut, the buffer
+ * holds exactly the prefix of f() and nothing past written is touched. Covers cuts in the
+ * middle of a number, of padding, of a range written in batches and of adapter output,
+ * and n == 0 with a null buffer.
+ *
+ *   g++ -std=c++17 -O2 -pthread -I.. format_to_n_test.cpp -o format_to_n_test
+ */
+#include "../AsulFormatString.h"
+#include "test_common.h"
+#include <algorithm>
+#include <vector>
+
+static const char guard = '\x7f';
+
+template <typename Fmt, typename... Args>
+static void everySize(AsulFormatString &afs, const std::string &what, const Fmt &fmt, const Args&... args) {
+    std::string full = afs.f(fmt, args...);
+    std::vector<char> buf(full.size() + 8);
+    bool ok = true;
+    for (size_t n = 0; n <= full.size() + 2 && ok; ++n) {
+        std::fill(buf.begin(), buf.end(), guard);
+        AsulFormatString::FormatToNResult r = afs.f_to_n(buf.data(), n, fmt, args...);
+        size_t written = std::min(n, full.size());
+        std::string at = what + ", n = " + std::to_string(n) + ": ";
+        ok = expect(at + "needed", r.needed, full.size())
+          && expect(at + "written", r.written, written)
+          && expect(at + "truncated()", r.truncated(), n < full.size())
+          && expect(at + "text", std::string(buf.data(), r.written), full.substr(0, written))
+          && expect(at + "bytes past written untouched",
+                    std::all_of(buf.begin() + static_cast<std::ptrdiff_t>(written), buf.end(), [](char c) { return c == guard; }), true);
+    }
+}
+
+int main() {
+    AsulFormatString afs;
+    everySize(afs, "numbers", "value {} {} {}", 123456789, -42.125, 18446744073709551615ull);
+    everySize(afs, "padding", "[[SETW:10]]{}|[[LEFT]][[FILL:*]][[SETW:8]]{}|", 12345, "ab");
+    everySize(afs, "precision", "[[FIXED]][[PREC:6]]{}", 3.14159265358979);
+    everySize(afs, "UTF-8 and ENDL", "\xE4\xBD\xA0\xE5\xA5\xBD {}[[ENDL]]", "\xC3\xA9");
+    everySize(afs, "AFS_FMT", AFS_FMT("[[SETW:6]]{} + {} = {}"), 1000, 2000, 3000);
+    afs.installLabelAdapter({{"TAG", "[tag]"}});
+    afs.installFormatAdapter({{"PAIR", "<{}:{}>"}});
+    everySize(afs, "adapters", "(TAG) {PAIR} (TAG)", 77, 88);
+    std::vector<int> ints(1500);
+    for (size_t i = 0; i < ints.size(); ++i) ints[i] = static_cast<int>(i * 7919);
+    everySize(afs, "range over several batches", "[[JOIN:,]]{}", ints);
+
+    // a cut inside a number keeps its leading digits
+    char buf[9];
+    AsulFormatString::FormatToNResult r = afs.f_to_n(buf, sizeof buf, "value {}", 123456789);
+    expect("mid-number: text", std::string(buf, r.written), "value 123");
+    expect("mid-number: needed", r.needed, size_t(15));
+    expect("mid-number: truncated()", r.truncated(), true);
+
+    // n == 0 writes nothing, so no buffer is needed
+    r = afs.f_to_n(nullptr, 0, "{} {}", 1, "two");
+    expect("n == 0: needed", r.needed, size_t(5));
+    expect("n == 0: written", r.written, size_t(0));
+    expect("n == 0: truncated()", r.truncated(), true);
+    r = afs.f_to_n(nullptr, 0, "");
+    expect("n == 0, empty output: truncated()", r.truncated(), false);
+
+    r = f_to_n(buf, 4, "{}", 98765);
+    expect("global f_to_n()", std::string(buf, r.written) + "/" + std::to_string(r.needed), "9876/5");
+    return testResult();
+}
@@ -0,0 +1,99 @@
+/*
+ * AsulFormatter specializations: picked ahead of operator<< and of the std::any fallback,
+ * padded by SETW / LEFT, selected through the Enable parameter for a family of types, and
+ * used for every element of a range ([[JOIN:sep]], maps, nested ranges) and for every
+ * cell of print_rows / f_rows, on one thread and on several.
+ *
+ *   g++ -std=c++17 -O2 -pthread -I.. formatter_test.cpp -o formatter_test
+ */
+#include "../AsulFormatString.h"
+#include "test_common.h"
+#include <atomic>
+#include <map>
+#include <ostream>
+#include <vector>
+
+static std::atomic<int> streamed{0};
+
+// has both an operator<< and an AsulFormatter: the formatter must win
+struct Point { int x, y; };
+inline std::ostream &operator<<(std::ostream &os, const Point &p) {
+    streamed.fetch_add(1, std::memory_order_relaxed);
+    return os << "stream:" << p.x << "," << p.y;
+}
+template <>
+struct AsulFormatter<Point> {
+    void format(const Point &p, AsulFormatString::Sink &out) const {
+        asul_formatter().print(out, "({}, {})", p.x, p.y);
+    }
+};
+
+// no operator<<: without the formatter it would go out as std::any
+struct Id { unsigned value; };
+template <>
+struct AsulFormatter<Id> {
+    void format(const Id &id, AsulFormatString::Sink &out) const {
+        out.write("#", 1);
+        std::string s = std::to_string(id.value);
+        out.write(s.data(), s.size());
+    }
+};
+
+// one partial specialization for a family of types, through Enable
+template <typename T>
+struct Meters { T value; };
+template <typename T>
+struct AsulFormatter<Meters<T>, std::enable_if_t<std::is_arithmetic_v<T>>> {
+    void format(const Meters<T> &m, AsulFormatString::Sink &out) const {
+        asul_formatter().print(out, "{}m", m.value);
+    }
+};
+
+int main() {
+    AsulFormatString afs;
+    expect("formatter over operator<<", afs.f("at {}", Point{3, 4}), "at (3, 4)");
+    expect("formatter over std::any", afs.f("{} {}", Id{7}, Id{42}), "#7 #42");
+    expect("Enable specialization, int", afs.f("{}", Meters<int>{5}), "5m");
+    expect("Enable specialization, double", afs.f("{}", Meters<double>{2.5}), "2.5m");
+    expect("SETW pads it", afs.f("[[SETW:8]]{}|", Point{1, 2}), "  (1, 2)|");
+    expect("LEFT SETW pads it", afs.f("[[LEFT]][[SETW:5]]{}|", Id{9}), "#9   |");
+
+    // the std::any route stays available to typed funcAdapters
+    afs.installTypedFuncAdapter<Id>("RAW", [](const Id &id) { return std::to_string(id.value); });
+    expect("typed funcAdapter", afs.f("{RAW} {}", Id{255}, Id{255}), "255 #255");
+
+    // ranges: every element through the formatter
+    std::vector<Point> points = {{1, 2}, {-3, 4}, {5, -6}};
+    expect("vector", afs.f("{}", points), "(1, 2), (-3, 4), (5, -6)");
+    expect("vector, JOIN", afs.f("[[JOIN: | ]]{}", points), "(1, 2) | (-3, 4) | (5, -6)");
+    expect("vector, SETW per element", afs.f("[[SETW:4]][[JOIN:,]]{}", std::vector<Id>{{1}, {22}}), "  #1, #22");
+    expect("empty vector", afs.f("<{}>", std::vector<Id>()), "<>");
+    std::map<std::string, Id> byName = {{"a", {1}}, {"b", {2}}};
+    expect("map values", afs.f("{}", byName), "a: #1, b: #2");
+    std::vector<std::vector<Meters<int>>> nested = {{{1}, {2}}, {{3}}};
+    expect("nested ranges", afs.f("{}", nested), "[1m, 2m], [3m]");
+
+    // table cells, on one thread and on four
+    std::vector<std::tuple<Id, Point>> rows;
+    std::string expected;
+    for (unsigned i = 0; i < 2000; ++i) {
+        Point p{static_cast<int>(i), -static_cast<int>(i)};
+        rows.emplace_back(Id{i}, p);
+        expected += afs.f("#{} ({}, {})\n", i, p.x, p.y);
+    }
+    AsulFormatString::TableOptions one, four;
+    four.threads = 4;
+    expect("f_rows", afs.f_rows("{} {}[[ENDL]]", rows, one), expected);
+    expect("f_rows, 4 threads", afs.f_rows("{} {}[[ENDL]]", rows, four), expected);
+    std::string printed;
+    AsulFormatString::StringSink sink(printed);
+    afs.print_rows(sink, "{} {}[[ENDL]]", rows, four);
+    expect("print_rows(sink), 4 threads", printed, expected);
+    one.autoWidth = four.autoWidth = true;
+    std::string aligned = afs.f_rows("{}|{}[[ENDL]]", rows, one);
+    expect("auto widths pad formatter output", aligned.substr(0, aligned.find('\n')), "   #0|       (0, 0)");
+    expect("auto widths, 4 threads", afs.f_rows("{}|{}[[ENDL]]", rows, four), aligned);
+
+    expect("operator<< never called", streamed.load(), 0);
+    return testResult();
+}
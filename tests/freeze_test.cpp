@@ -0,0 +1,74 @@
+/*
+ * freeze() against the unordered_map registry: 5000 labels, formats and funcAdapters
+ * (enough that many buckets need a seed other than the first) resolve to the same output
+ * after freezing, names that are not registered, including near misses of registered
+ * ones, still stay literal, and any install* / clear* afterwards unfreezes.
+ *
+ *   g++ -std=c++17 -O2 -pthread -I.. freeze_test.cpp -o freeze_test
+ */
+#include "../AsulFormatString.h"
+#include "test_common.h"
+#include <vector>
+
+int main() {
+    const size_t count = 5000;
+    AsulFormatString afs;
+    AsulFormatString::AdapterMap labels, formats;
+    AsulFormatString::FuncMap funcs;
+    for (size_t i = 0; i < count; ++i) {
+        std::string n = std::to_string(i);
+        labels["L" + n] = "label" + n;
+        formats["F" + n] = "<" + n + ":{}>";
+        if (i % 10 == 0) {
+            funcs["X" + n] = [i](const AsulFormatString::VariantType &v) {
+                return std::to_string(i) + "*" + AsulFormatString::variantToString(v);
+            };
+        }
+        // the same name as a label and a format adapter
+        if (i % 7 == 0) labels["F" + n] = "both" + n;
+    }
+    afs.installLabelAdapter(labels);
+    afs.installFormatAdapter(formats);
+    afs.installFuncFormatAdapter(funcs);
+    afs.setFormatCacheCapacity(0);
+
+    std::vector<std::string> fmts;
+    for (size_t i = 0; i < count; ++i) {
+        std::string n = std::to_string(i);
+        fmts.push_back("(L" + n + ") {F" + n + "} (F" + n + ") {X" + n + "}");
+    }
+    // unknown names: past the end, prefixes, suffixes, other case, empty
+    const std::vector<std::string> unknown = {
+        "(L5000) {F5000} {X5001}", "(L) {F} {X}", "(L12x) {F12 } (l12) {f12}", "(L00) {F01}", "(() {{}}",
+    };
+    std::vector<std::string> before, unknownBefore;
+    for (const std::string &fmt : fmts) before.push_back(afs.f(fmt, 1, 2));
+    for (const std::string &fmt : unknown) unknownBefore.push_back(afs.f(fmt, 1, 2));
+    expect("map registry spot check", before[70], "label70 <70:1> both70 70*2");
+    expect("unknown names spot check", unknownBefore[0], "(L5000) {F5000} {X5001}");
+
+    expect("freeze()", afs.freeze(), true);
+    expect("frozen()", afs.frozen(), true);
+    size_t differ = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (afs.f(fmts[i], 1, 2) != before[i] && differ++ < 5) expect(fmts[i], afs.f(fmts[i], 1, 2), before[i]);
+    }
+    expect("keys resolving differently when frozen", differ, size_t(0));
+    for (size_t i = 0; i < unknown.size(); ++i) expect("frozen " + unknown[i], afs.f(unknown[i], 1, 2), unknownBefore[i]);
+
+    // mutating unfreezes
+    afs.installLabelAdapter({{"NEW", "new"}});
+    expect("install after freeze unfreezes", afs.frozen(), false);
+    expect("label installed after freeze", afs.f("(NEW) (L3)"), "new label3");
+    expect("freeze again", afs.freeze(), true);
+    expect("label frozen the second time", afs.f("(NEW) (L3)"), "new label3");
+    afs.clearFormatAdapter();
+    expect("clear after freeze unfreezes", afs.frozen(), false);
+    expect("cleared format adapter", afs.f("{F3} (F7)", 1), "{F3} both7");
+
+    // an empty registry freezes too, and finds nothing
+    AsulFormatString empty;
+    expect("freeze() empty", empty.freeze(), true);
+    expect("empty frozen lookup", empty.f("(L1) {F1} {}", 1), "(L1) {F1} 1");
+    return testResult();
+}
@@ -0,0 +1,87 @@
+/*
+ * The MetaScanner kernels against each other: the scalar loop, SSE2 and AVX2 (when the
+ * build and the CPU have them) must report the same list of meta byte offsets, which is
+ * where the format compiler splits literals from {} / (LABEL) / [[...]] ops. Inputs put
+ * brackets on both sides of the 16 and 32 byte vector edges, are shorter than one vector,
+ * or mix in ESC and bytes with the high bit set, plus random formats of every length.
+ *
+ *   g++ -std=c++17 -O2 -pthread -I.. meta_scan_test.cpp -o meta_scan_test
+ */
+#include "../AsulFormatString.h"
+#include "test_common.h"
+#include <random>
+#include <vector>
+
+using Scanner = AsulFormatString::MetaScanner;
+
+// Offsets of every meta byte, found the way the compiler walks a format
+static std::vector<size_t> metaOffsets(Scanner::ScanFn fn, const std::string &s) {
+    std::vector<size_t> found;
+    for (size_t i = 0; i < s.size(); ++i) {
+        i += fn(s.data() + i, s.size() - i);
+        if (i < s.size()) found.push_back(i);
+    }
+    return found;
+}
+
+static std::string joined(const std::vector<size_t> &v) {
+    std::string s;
+    for (size_t x : v) s += std::to_string(x) + ' ';
+    return s;
+}
+
+struct Kernel { const char *name; Scanner::ScanFn fn; };
+
+static void compare(const std::vector<Kernel> &kernels, const std::string &input, const std::string &what) {
+    std::string expected = joined(metaOffsets(Scanner::scalar, input));
+    for (const Kernel &k : kernels) expect(what + " " + k.name, joined(metaOffsets(k.fn, input)), expected);
+}
+
+int main() {
+    std::vector<Kernel> kernels;
+#ifdef ASUL_FORMAT_STRING_SSE2
+    kernels.push_back({"sse2", Scanner::sse2});
+#endif
+#ifdef ASUL_FORMAT_STRING_AVX2
+    if (__builtin_cpu_supports("avx2")) kernels.push_back({"avx2", Scanner::avx2});
+#endif
+    std::printf("kernels against scalar: %zu, find() uses %s\n", kernels.size(), Scanner::path());
+
+    const char metas[] = {'[', ']', '{', '}', '(', ')', '\033'};
+    // one meta byte at every offset around the vector edges, in texts of every length up to 70
+    for (size_t len = 0; len <= 70; ++len) {
+        for (size_t at : {size_t(0), size_t(1), size_t(14), size_t(15), size_t(16), size_t(17),
+                          size_t(30), size_t(31), size_t(32), size_t(33), size_t(63), size_t(64)}) {
+            if (at >= len) continue;
+            for (char m : metas) {
+                std::string s(len, 'a');
+                s[at] = m;
+                compare(kernels, s, "len " + std::to_string(len) + " '" + std::string(1, m) + "' at " + std::to_string(at));
+            }
+        }
+    }
+    // bytes next to the meta bytes that differ in one bit ('*' and '+' sit by '(' / ')',
+    // 'z' and '|' by '{' / '}', 'Z' and '\\' by '[' / ']') and high-bit bytes whose low
+    // seven bits are a meta byte
+    std::string neighbours = "*+z|Z\\^\x1A\x1C";
+    for (char m : metas) neighbours += static_cast<char>(static_cast<unsigned char>(m) | 0x80);
+    neighbours += "\xE4\xBD\xA0\xF0\x9F\x98\x80";
+    for (size_t shift = 0; shift < 40; ++shift) {
+        std::string s(shift, 'x');
+        for (int r = 0; r < 4; ++r) s += neighbours;
+        compare(kernels, s, "neighbour bytes shifted " + std::to_string(shift));
+        compare(kernels, s + "[[", "neighbour bytes then [[ shifted " + std::to_string(shift));
+    }
+    // typical formats cut at every length
+    const std::string fmt = "(INFO) \xE4\xBD\xA0\xE5\xA5\xBD [[LEFT]][[SETW:12]]{} | {RED} took {} ms\033[0m [[JOIN:, ]]{}[[ENDL]]";
+    for (size_t len = 0; len <= fmt.size(); ++len) compare(kernels, fmt.substr(0, len), "format prefix " + std::to_string(len));
+
+    std::mt19937 rng(12345);
+    const std::string alphabet = "abc []{}()\033\x80\xFF\xC3\xA9";
+    for (int round = 0; round < 2000; ++round) {
+        std::string s(rng() % 100, ' ');
+        for (char &c : s) c = rng() % 4 ? 'a' + static_cast<char>(rng() % 26) : alphabet[rng() % alphabet.size()];
+        compare(kernels, s, "random " + std::to_string(round));
+    }
+    return testResult();
+}
@@ -0,0 +1,58 @@
+/*
+ * The natively formatted argument types against what std::ostream prints for the same
+ * value under the same [[SETW]] / [[FILL]] / [[LEFT]] / [[PREC]] / [[FIXED]] /
+ * [[SCIENTIFIC]] directives.
+ *
+ *   g++ -std=c++17 -O2 -pthread -I.. ostream_test.cpp -o ostream_test
+ */
+#include "../AsulFormatString.h"
+#include "test_common.h"
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+
+struct Modifiers {
+    const char *directives;
+    void (*apply)(std::ostream &);
+};
+static const Modifiers modifiers[] = {
+    {"", [](std::ostream &) {}},
+    {"[[SETW:12]]", [](std::ostream &os) { os << std::setw(12); }},
+    {"[[LEFT]][[SETW:12]][[FILL:*]]", [](std::ostream &os) { os << std::left << std::setw(12) << std::setfill('*'); }},
+    {"[[PREC:3]]", [](std::ostream &os) { os << std::setprecision(3); }},
+    {"[[FIXED]][[PREC:2]]", [](std::ostream &os) { os << std::fixed << std::setprecision(2); }},
+    {"[[SCIENTIFIC]][[PREC:4]][[SETW:16]]", [](std::ostream &os) { os << std::scientific << std::setprecision(4) << std::setw(16); }},
+};
+
+template <typename T>
+static void compare(const char *type, const T &value) {
+    for (const Modifiers &m : modifiers) {
+        std::ostringstream oss;
+        m.apply(oss);
+        oss << value;
+        std::string fmt = std::string(m.directives) + "{}";
+        expect(std::string(type) + " " + m.directives, asul_formatter().f(fmt, value), oss.str());
+    }
+}
+
+int main() {
+    compare("short", static_cast<short>(-1234));
+    compare("unsigned", 4000000000u);
+    compare("long", -9000000000000L);
+    compare("unsigned long long", 18446744073709551615ull);
+    compare("size_t", static_cast<size_t>(42));
+    compare("int64_t", static_cast<int64_t>(INT64_MIN));
+    compare("float", 3.14159f);
+    compare("double", 2.0 / 3.0);
+    compare("long double", 1.0L / 7.0L);
+    compare("signed char", static_cast<signed char>('s'));
+    compare("unsigned char", static_cast<unsigned char>('u'));
+    compare("std::string_view", std::string_view("view"));
+    int object = 0;
+    compare("int*", &object);
+    compare("const void*", static_cast<const void*>(&object));
+    compare("null void*", static_cast<void*>(nullptr));
+    compare("null int*", static_cast<int*>(nullptr));
+    compare("std::nullptr_t", nullptr);
+    return testResult();
+}
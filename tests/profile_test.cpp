@@ -0,0 +1,175 @@
+/*
+ * Per format string profile (ALLOW_PROFILE_ASULFORMATSTRING, CMake -DAFS_PROFILE=ON):
+ * two distinct formats called a known number of times, from this thread and another one,
+ * must show their own calls, output bytes, arguments and allocations in stats(), in the
+ * text() table and in the json() dump; control bytes and quotes are escaped, and
+ * resetStats() empties it. Threads that exit leave their counts in stats() and resetStats()
+ * clears those too; a thread outliving its instance exits cleanly. tests/CMakeLists.txt
+ * builds this one with the define.
+ *
+ *   g++ -std=c++17 -O2 -pthread -DALLOW_PROFILE_ASULFORMATSTRING -I.. profile_test.cpp -o profile_test
+ */
+#include "../AsulFormatString.h"
+#include "test_common.h"
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#ifndef ALLOW_PROFILE_ASULFORMATSTRING
+#error "profile_test needs ALLOW_PROFILE_ASULFORMATSTRING"
+#endif
+
+// Ticks on every read: a profiled call reads it before and after, so it records 1
+static uint64_t ticks() {
+    thread_local uint64_t n = 0;
+    return n++;
+}
+
+static const AsulFormatString::FormatStats *find(const AsulFormatString::StatsSnapshot &snap, const std::string &fmt) {
+    for (const auto &s : snap.formats)
+        if (s.format == fmt) return &s;
+    return nullptr;
+}
+
+// The counters of the text() line whose format column is shown
+static std::vector<uint64_t> textRow(const std::string &text, const std::string &shown) {
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (line.size() < shown.size() + 2 || line.compare(line.size() - shown.size() - 2, std::string::npos, "  " + shown) != 0) continue;
+        std::istringstream cols(line.substr(0, line.size() - shown.size()));
+        std::vector<uint64_t> row;
+        uint64_t v;
+        while (cols >> v) row.push_back(v);
+        return row;
+    }
+    return {};
+}
+
+static bool has(const std::string &text, const std::string &part) {
+    return text.find(part) != std::string::npos;
+}
+
+int main() {
+    AsulFormatString afs;
+    AsulFormatString::setProfileAllocationCounter(ticks);
+    const std::string alpha = "alpha {}";
+    const std::string beta = "beta \"{}\"\t{}[[ENDL]]";
+    std::string out;
+    AsulFormatString::StringSink sink(out);
+    for (int i = 0; i < 3; ++i) afs.print(sink, alpha, 7);
+    for (int i = 0; i < 4; ++i) afs.print(sink, beta, "x", 10);
+    std::thread other([&] {
+        std::string mine;
+        AsulFormatString::StringSink s(mine);
+        afs.print(s, beta, "y", 20);
+    });
+    other.join();
+
+    AsulFormatString::StatsSnapshot snap = afs.stats();
+    expect("two formats", snap.formats.size(), size_t(2));
+    const AsulFormatString::FormatStats *a = find(snap, alpha);
+    const AsulFormatString::FormatStats *b = find(snap, beta);
+    expect("alpha recorded", a != nullptr, true);
+    expect("beta recorded", b != nullptr, true);
+    if (!a || !b) return testResult();
+    expect("alpha calls", a->calls, uint64_t(3));
+    expect("alpha bytes", a->outputBytes, uint64_t(3 * afs.f(alpha, 7).size()));
+    expect("alpha args", a->argsConsumed, uint64_t(3));
+    expect("alpha allocations", a->allocations, uint64_t(3));
+    expect("alpha lookups", a->adapterLookups, uint64_t(0));
+    expect("beta calls, both threads", b->calls, uint64_t(5));
+    expect("beta bytes", b->outputBytes, uint64_t(4 * afs.f(beta, "x", 10).size() + afs.f(beta, "y", 20).size()));
+    expect("beta args", b->argsConsumed, uint64_t(10));
+    expect("beta allocations", b->allocations, uint64_t(5));
+    expect("max <= total", a->maxNs <= a->totalNs && b->maxNs <= b->totalNs, true);
+
+    // text(): calls, total, max, avg, bytes, args, lookups, allocs, then the format escaped
+    std::string text = snap.text();
+    std::vector<uint64_t> ta = textRow(text, alpha);
+    std::vector<uint64_t> tb = textRow(text, "beta \"{}\"\\t{}[[ENDL]]");
+    expect("text(): header", text.compare(0, 5, "calls"), 0);
+    expect("text(): alpha row", ta == std::vector<uint64_t>{a->calls, a->totalNs, a->maxNs, a->totalNs / a->calls,
+                                                             a->outputBytes, a->argsConsumed, a->adapterLookups, a->allocations}, true);
+    expect("text(): beta row", tb == std::vector<uint64_t>{b->calls, b->totalNs, b->maxNs, b->totalNs / b->calls,
+                                                            b->outputBytes, b->argsConsumed, b->adapterLookups, b->allocations}, true);
+    expect("text(): one line per format", std::count(text.begin(), text.end(), '\n'), 3);
+
+    std::string json = snap.json();
+    expect("json(): alpha", has(json, "{\"format\":\"alpha {}\",\"calls\":3,\"total_ns\":" + std::to_string(a->totalNs) +
+                                      ",\"max_ns\":" + std::to_string(a->maxNs) + ",\"output_bytes\":" + std::to_string(a->outputBytes) +
+                                      ",\"args_consumed\":3,\"adapter_lookups\":0,\"allocations\":3}"), true);
+    expect("json(): beta", has(json, "{\"format\":\"beta \\\"{}\\\"\\t{}[[ENDL]]\",\"calls\":5,"), true);
+    expect("json(): beta counters", has(json, ",\"output_bytes\":" + std::to_string(b->outputBytes) +
+                                              ",\"args_consumed\":10,\"adapter_lookups\":0,\"allocations\":5}"), true);
+    expect("json(): array", json.front() == '[' && json.back() == ']', true);
+
+    // adapter lookups happen when a format is compiled, not on cached calls
+    afs.installLabelAdapter({{"TAG", "[tag]"}});
+    for (int i = 0; i < 3; ++i) afs.print(sink, "(TAG) {}", i);
+    snap = afs.stats();
+    const AsulFormatString::FormatStats *tag = find(snap, "(TAG) {}");
+    expect("label lookups", tag ? tag->adapterLookups : 0, uint64_t(1));
+
+    AsulFormatString::setProfileAllocationCounter(nullptr);
+    afs.resetStats();
+    expect("resetStats()", afs.stats().formats.size(), size_t(0));
+    expect("resetStats(): json()", afs.stats().json(), "[]");
+    afs.print(sink, alpha, 1);
+    snap = afs.stats();
+    a = find(snap, alpha);
+    expect("after reset", a ? a->calls : 0, uint64_t(1));
+    expect("no allocation counter", a ? a->allocations : 1, uint64_t(0));
+
+    // short-lived threads: their tables are merged into the exited counts when they end
+    const std::string gamma = "gamma {}";
+    for (int round = 0; round < 8; ++round) {
+        std::vector<std::thread> workers;
+        for (int t = 0; t < 4; ++t) {
+            workers.emplace_back([&] {
+                std::string mine;
+                AsulFormatString::StringSink s(mine);
+                for (int i = 0; i < 5; ++i) afs.print(s, gamma, i);
+            });
+        }
+        for (std::thread &w : workers) w.join();
+    }
+    for (int i = 0; i < 2; ++i) afs.print(sink, gamma, i);
+    snap = afs.stats();
+    const AsulFormatString::FormatStats *g = find(snap, gamma);
+    expect("exited threads: calls", g ? g->calls : 0, uint64_t(8 * 4 * 5 + 2));
+    expect("exited threads: args", g ? g->argsConsumed : 0, uint64_t(8 * 4 * 5 + 2));
+    afs.resetStats();
+    expect("resetStats(): exited threads", afs.stats().formats.size(), size_t(0));
+
+    // the instance goes first, the thread that used it exits afterwards
+    std::mutex m;
+    std::condition_variable cv;
+    int step = 0;
+    auto gone = std::make_unique<AsulFormatString>();
+    std::thread outliving([&] {
+        std::string mine;
+        AsulFormatString::StringSink s(mine);
+        gone->print(s, gamma, 1);
+        std::unique_lock<std::mutex> lock(m);
+        step = 1;
+        cv.notify_all();
+        cv.wait(lock, [&] { return step == 2; });
+        // its entry for the destroyed instance is dropped when another instance is used
+        afs.print(s, gamma, 2);
+    });
+    {
+        std::unique_lock<std::mutex> lock(m);
+        cv.wait(lock, [&] { return step == 1; });
+        expect("outliving thread: calls", gone->stats().formats.size(), size_t(1));
+        gone.reset();
+        step = 2;
+        cv.notify_all();
+    }
+    outliving.join();
+    snap = afs.stats();
+    g = find(snap, gamma);
+    expect("after instance destroyed", g ? g->calls : 0, uint64_t(1));
+    return testResult();
+}
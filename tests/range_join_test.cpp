@@ -0,0 +1,94 @@
+/*
+ * Ranges as {} arguments against formatting each element with f() and joining by hand:
+ * empty ranges, one element, [[JOIN:sep]] separators including escaped {{ / (( and lone
+ * brackets, nested containers and maps, and numeric ranges long enough to go through the
+ * batched writeNumbers path several buffers over, under SETW / FILL / PREC / FIXED.
+ *
+ *   g++ -std=c++17 -O2 -pthread -I.. range_join_test.cpp -o range_join_test
+ */
+#include "../AsulFormatString.h"
+#include "test_common.h"
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+
+static AsulFormatString afs;
+
+// directives + "{}" per element, joined by sep
+template <typename R>
+static std::string elementWise(const std::string &directives, const R &r, const std::string &sep) {
+    std::string out;
+    bool first = true;
+    for (const auto &e : r) {
+        if (!first) out += sep;
+        first = false;
+        out += afs.f(directives + "{}", e);
+    }
+    return out;
+}
+
+template <typename R>
+static void compare(const std::string &what, const std::string &directives, const R &r, const std::string &sep = ", ") {
+    expect(what, afs.f("<" + directives + "{}>", r), "<" + elementWise(directives, r, sep) + ">");
+}
+
+int main() {
+    std::vector<int> none;
+    compare("empty vector", "", none);
+    compare("empty vector, JOIN", "[[JOIN:--]]", none, "--");
+    compare("empty set", "", std::set<std::string>());
+    expect("empty range, temporary SETW ends after it", afs.f("[[SETW:4]]{}|{}", none, 1), "|1");
+
+    compare("one int", "[[JOIN:--]]", std::vector<int>{42}, "--");
+    compare("one string", "[[JOIN:--]]", std::list<std::string>{"only"}, "--");
+    compare("one double", "[[FIXED]][[PREC:2]]", std::array<double, 1>{2.5});
+
+    std::vector<int> three = {1, -2, 3};
+    compare("default separator", "", three);
+    compare("empty separator", "[[JOIN:]]", three, "");
+    compare("escaped {{ and ((", "[[JOIN:{{x} ((y) ]]", three, "{x} (y) ");
+    compare("escaped {{ next to an argument", "[[JOIN:{{}]][[SETW:3]]", three, "{}");
+    compare("lone brackets", "[[JOIN:] [ )]]", three, "] [ )");
+    afs.installLabelAdapter({{"SEP", " / "}});
+    compare("separator expanding a label", "[[JOIN:(SEP)]]", three, " / ");
+    const char *words[] = {"a", "bb", "ccc"};
+    compare("C array, LEFT SETW", "[[LEFT]][[SETW:4]][[JOIN:|]]", words, "|");
+
+    std::vector<std::vector<int>> nested = {{1, 2}, {}, {3}};
+    expect("nested vectors", afs.f("{}", nested), "[" + elementWise("", nested[0], ", ") + "], [], [" + elementWise("", nested[2], ", ") + "]");
+    expect("nested vectors, JOIN", afs.f("[[JOIN:; ]]{}", nested), "[1; 2]; []; [3]");
+    std::map<std::string, std::vector<int>> byName = {{"a", {1}}, {"b", {2, 3}}};
+    expect("map of vectors", afs.f("[[JOIN:; ]]{}", byName), "a: [1]; b: [2; 3]");
+    std::map<int, double> byId = {{1, 0.5}, {2, 1.25}};
+    expect("map, PREC", afs.f("[[PREC:2]]{}", byId), afs.f("[[PREC:2]]{}: {}, {}: {}", 1, 0.5, 2, 1.25));
+
+    // several 4 KiB buffers of digits, separators and padding
+    std::vector<int> ints(5000);
+    std::vector<int64_t> wide(3000);
+    std::vector<double> doubles(3000);
+    std::vector<float> floats(2000);
+    for (size_t i = 0; i < ints.size(); ++i) ints[i] = static_cast<int>(i * 2654435761u) / 7;
+    for (size_t i = 0; i < wide.size(); ++i) wide[i] = static_cast<int64_t>(i * 0x9E3779B97F4A7C15ull);
+    for (size_t i = 0; i < doubles.size(); ++i) doubles[i] = (static_cast<double>(i) - 1500.0) / 7.0;
+    for (size_t i = 0; i < floats.size(); ++i) floats[i] = static_cast<float>(i) * 0.37f;
+    ints[0] = INT_MIN;
+    ints[1] = INT_MAX;
+    wide[0] = INT64_MIN;
+    doubles[0] = 1e300;
+    doubles[1] = -1e-300;
+    compare("5000 ints", "", ints);
+    compare("5000 ints, SETW FILL JOIN", "[[SETW:12]][[FILL:0]][[JOIN: | ]]", ints, " | ");
+    compare("5000 ints, LEFT SETW", "[[LEFT]][[SETW:14]]", ints);
+    compare("3000 int64", "[[JOIN:,]]", wide, ",");
+    compare("3000 doubles", "", doubles);
+    compare("3000 doubles, FIXED PREC", "[[FIXED]][[PREC:3]][[SETW:10]]", doubles);
+    compare("3000 doubles, SCIENTIFIC", "[[SCIENTIFIC]][[PREC:4]][[JOIN:;]]", doubles, ";");
+    compare("2000 floats", "", floats);
+    compare("ints, SETW wider than a buffer", "[[SETW:5000]][[JOIN:/]]", std::vector<int>(ints.begin(), ints.begin() + 3), "/");
+    compare("doubles, PREC past a buffer", "[[FIXED]][[PREC:4500]]", std::vector<double>{1.0 / 3.0, 2.0});
+    return testResult();
+}
@@ -0,0 +1,120 @@
+/*
+ * FileSink, FdSink and OStreamSink: print(sink, ...) through each one (a tmpfile, a pipe
+ * and a std::ostringstream) writes the same bytes as f() with the same arguments, and a
+ * write that fails (a closed fd, /dev/null opened for reading, an ostream without a
+ * buffer) shows up as failed() / error() or the stream's badbit. A FixedBufferSink
+ * that truncated keeps the prefix of f() and copies it to a file as is. POSIX only
+ * (pipe and close).
+ *
+ *   g++ -std=c++17 -O2 -pthread -I.. sink_test.cpp -o sink_test
+ */
+#include "../AsulFormatString.h"
+#include "test_common.h"
+#include <cerrno>
+#include <cstdio>
+#include <sstream>
+#include <unistd.h>
+
+// Everything written to fp so far
+static std::string contents(std::FILE *fp) {
+    std::fflush(fp);
+    std::rewind(fp);
+    std::string got;
+    char buf[256];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof buf, fp)) > 0) got.append(buf, n);
+    return got;
+}
+
+// Whatever is in the pipe once its write end is closed
+static std::string drain(int fd) {
+    std::string got;
+    char buf[256];
+    ssize_t n;
+    while ((n = ::read(fd, buf, sizeof buf)) > 0) got.append(buf, static_cast<size_t>(n));
+    return got;
+}
+
+int main() {
+    AsulFormatString afs;
+    const std::string fmt = "{RED} {} {} {} [[SETW:8]]{}|[[ENDL]]";
+    const std::string expected = afs.f(fmt, "sink", 42, 2.5, true, "pad");
+
+    std::FILE *fp = std::tmpfile();
+    if (!expect("tmpfile", fp != nullptr, true)) return testResult();
+    {
+        AsulFormatString::FileSink sink(fp);
+        afs.print(sink, fmt, "sink", 42, 2.5, true, "pad");
+        afs.print(sink, "{}", 7);
+        sink.flush();
+        expect("FileSink", contents(fp), expected + "7");
+        expect("FileSink: failed()", sink.failed(), false);
+    }
+    std::fclose(fp);
+
+    int fds[2];
+    if (!expect("pipe", ::pipe(fds), 0)) return testResult();
+    {
+        AsulFormatString::FdSink sink(fds[1]);
+        afs.print(sink, fmt, "sink", 42, 2.5, true, "pad");
+        afs.print(sink, "{}", 7);
+        expect("FdSink: failed()", sink.failed(), false);
+        expect("FdSink: error()", sink.error(), 0);
+    }
+    ::close(fds[1]);
+    expect("FdSink", drain(fds[0]), expected + "7");
+    ::close(fds[0]);
+
+    std::ostringstream os;
+    {
+        AsulFormatString::OStreamSink sink(os);
+        afs.print(sink, fmt, "sink", 42, 2.5, true, "pad");
+        afs.print(sink, "{}", 7);
+        sink.flush();
+    }
+    expect("OStreamSink", os.str(), expected + "7");
+    expect("OStreamSink: good()", os.good(), true);
+
+    // failing writes: a closed fd, a stream opened for reading, an ostream without a buffer
+    if (!expect("pipe for a closed fd", ::pipe(fds), 0)) return testResult();
+    ::close(fds[0]);
+    ::close(fds[1]);
+    {
+        AsulFormatString::FdSink sink(fds[1]);
+        afs.print(sink, fmt, "sink", 42, 2.5, true, "pad");
+        expect("closed fd: failed()", sink.failed(), true);
+        expect("closed fd: error()", sink.error(), EBADF);
+    }
+    fp = std::fopen("/dev/null", "r");
+    if (!expect("read-only stream", fp != nullptr, true)) return testResult();
+    {
+        AsulFormatString::FileSink sink(fp);
+        afs.print(sink, fmt, "sink", 42, 2.5, true, "pad");
+        sink.flush();
+        expect("read-only stream: failed()", sink.failed(), true);
+    }
+    std::fclose(fp);
+    {
+        std::ostream unbuffered(nullptr);
+        AsulFormatString::OStreamSink sink(unbuffered);
+        afs.print(sink, fmt, "sink", 42, 2.5, true, "pad");
+        expect("ostream without buffer: bad()", unbuffered.bad(), true);
+    }
+
+    // FixedBufferSink truncated through print(sink, ...), then written to a file
+    char buf[10];
+    AsulFormatString::FixedBufferSink fixed(buf, sizeof buf);
+    afs.print(fixed, fmt, "sink", 42, 2.5, true, "pad");
+    expect("truncated", fixed.truncated(), true);
+    expect("truncated: size()", fixed.size(), sizeof buf);
+    expect("truncated: needed()", fixed.needed(), expected.size());
+    fp = std::tmpfile();
+    if (!expect("tmpfile for the prefix", fp != nullptr, true)) return testResult();
+    {
+        AsulFormatString::FileSink sink(fp);
+        sink.write(buf, fixed.size());
+        expect("truncated prefix in a file", contents(fp), expected.substr(0, sizeof buf));
+    }
+    std::fclose(fp);
+    return testResult();
+}
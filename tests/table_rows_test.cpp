@@ -0,0 +1,117 @@
+/*
+ * print_rows on several threads against the same table on one, for random access and
+ * node based row ranges and for columns, with and without auto widths. A forward-only
+ * range counts iterator steps: splitting a table into blocks must walk it once, not once
+ * per block. A row failing on its arguments ends the table after the row before it,
+ * with no part of the failing row written, on one thread and on several.
+ *
+ *   g++ -std=c++17 -O2 -pthread -I.. table_rows_test.cpp -o table_rows_test
+ */
+#include "../AsulFormatString.h"
+#include "test_common.h"
+#include <any>
+#include <forward_list>
+#include <list>
+#include <map>
+
+// Forward iteration over a vector, counting every ++ on any of its iterators (worker
+// threads step them too)
+struct CountingRows {
+    using Row = std::tuple<int, std::string>;
+    struct iterator {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Row;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Row*;
+        using reference = const Row&;
+        const Row *p;
+        std::atomic<size_t> *steps;
+        const Row &operator*() const { return *p; }
+        iterator &operator++() { ++p; steps->fetch_add(1, std::memory_order_relaxed); return *this; }
+        iterator operator++(int) { iterator old = *this; ++*this; return old; }
+        bool operator==(const iterator &o) const { return p == o.p; }
+        bool operator!=(const iterator &o) const { return p != o.p; }
+    };
+    std::vector<Row> data;
+    mutable std::atomic<size_t> steps{0};
+    iterator begin() const { return iterator{data.data(), &steps}; }
+    iterator end() const { return iterator{data.data() + data.size(), &steps}; }
+};
+
+template <typename Rows>
+static void compare(const char *what, const Rows &rows, const char *fmt) {
+    AsulFormatString afs;
+    for (bool autoWidth : {false, true}) {
+        AsulFormatString::TableOptions one, many;
+        one.autoWidth = many.autoWidth = autoWidth;
+        many.threads = 4;
+        std::string expected = afs.f_rows(fmt, rows, one);
+        std::string got = afs.f_rows(fmt, rows, many);
+        std::string name = std::string(what) + (autoWidth ? ", auto widths" : "");
+        expect(name + ": non-empty", !expected.empty(), true);
+        expect(name, got, expected);
+    }
+}
+
+int main() {
+    const size_t n = 20000;
+    std::vector<std::tuple<int, std::string> > vec;
+    std::list<std::tuple<int, std::string> > list;
+    std::map<int, std::string> map;
+    std::vector<int> ids;
+    std::list<std::string> names;
+    CountingRows counted;
+    for (size_t i = 0; i < n; ++i) {
+        int id = static_cast<int>(i * 7919 % 100003);
+        std::string name = "row-" + std::to_string(i % 977);
+        vec.emplace_back(id, name);
+        list.emplace_back(id, name);
+        map.emplace(id, name);
+        ids.push_back(id);
+        names.push_back(name);
+        counted.data.emplace_back(id, name);
+    }
+    const char *fmt = "[[LEFT]]{} | {}[[ENDL]]";
+    compare("std::vector rows", vec, fmt);
+    compare("std::list rows", list, fmt);
+    compare("std::map rows", map, fmt);
+    compare("columns(vector, list)", AsulFormatString::columns(ids, names), fmt);
+
+    // one count, one walk for the block starts, one pass formatting and one measuring
+    AsulFormatString afs;
+    AsulFormatString::TableOptions many;
+    many.threads = 4;
+    many.autoWidth = true;
+    counted.steps = 0;
+    std::string table = afs.f_rows(fmt, counted, many);
+    expect("forward range rows written", static_cast<size_t>(std::count(table.begin(), table.end(), '\n')), n);
+    expect("forward range walked at most 4n steps", counted.steps.load() <= 4 * n, true);
+
+    // the second row's std::any holds no int for {num}
+    afs.installTypedFuncAdapter<int>("num", [](int v) { return std::to_string(v); });
+    std::vector<std::tuple<int, std::any> > bad = {{1, 50}, {2, std::string("x")}};
+    std::string out;
+    AsulFormatString::StringSink sink(out);
+    AsulFormatString::FormatIssue issue = afs.try_print_rows(sink, "row {} {num}\n", bad);
+    expect("failing row: issue", issue.ok(), false);
+    expect("failing row: nothing of it written", out, "row 1 50\n");
+
+    // the same on several threads, the failing row in the middle of a block
+    std::vector<std::tuple<int, std::any> > badMany;
+    std::string expected;
+    for (int i = 0; i < 1000; ++i) {
+        if (i == 700) badMany.emplace_back(i, std::string("x"));
+        else badMany.emplace_back(i, i * 10);
+        if (i < 700) expected += "row " + std::to_string(i) + " " + std::to_string(i * 10) + "\n";
+    }
+    for (unsigned threads : {1u, 4u}) {
+        AsulFormatString::TableOptions opts;
+        opts.threads = threads;
+        out.clear();
+        issue = afs.try_print_rows(sink, "row {} {num}\n", badMany, opts);
+        std::string name = "failing row, " + std::to_string(threads) + " threads";
+        expect(name + ": issue", issue.ok(), false);
+        expect(name + ": rows before it", out, expected);
+    }
+    return testResult();
+}
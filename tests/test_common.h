@@ -0,0 +1,61 @@
+#ifndef AFS_TEST_COMMON_H
+#define AFS_TEST_COMMON_H
+
+// Shared by the tests/ programs: expect() counts checks and prints every mismatch with
+// both values escaped, main() returns testResult(), 1 if any check failed.
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+inline size_t testChecks = 0;
+inline size_t testFailures = 0;
+
+// Text with ESC, control and non-ASCII bytes spelled out, so two outputs that differ
+// only in an escape sequence or a UTF-8 byte show where
+inline std::string escaped(std::string_view s) {
+    static const char hex[] = "0123456789ABCDEF";
+    std::string out = "\"";
+    for (char ch : s) {
+        unsigned char c = static_cast<unsigned char>(ch);
+        if (c == 27) out += "\\e";
+        else if (c == '\n') out += "\\n";
+        else if (c == '\t') out += "\\t";
+        else if (c == '"' || c == '\\') { out += '\\'; out += ch; }
+        else if (c < 0x20 || c >= 0x7F) { out += "\\x"; out += hex[c >> 4]; out += hex[c & 15]; }
+        else out += ch;
+    }
+    return out + "\"";
+}
+template <typename T>
+std::string shown(const T &v) {
+    if constexpr (std::is_same_v<T, bool>) return v ? "true" : "false";
+    else if constexpr (std::is_convertible_v<const T&, std::string_view>) return escaped(v);
+    else if constexpr (std::is_enum_v<T>) return std::to_string(static_cast<long long>(v));
+    else return std::to_string(v);
+}
+
+// got == expected, else a FAIL line with both values
+template <typename Got, typename Expected>
+bool expect(const char *what, const Got &got, const Expected &expected) {
+    ++testChecks;
+    bool same;
+    if constexpr (std::is_arithmetic_v<Got> && std::is_arithmetic_v<Expected>) same = got == static_cast<Got>(expected);
+    else same = got == expected;
+    if (same) return true;
+    ++testFailures;
+    std::printf("FAIL %s\n     got      %s\n     expected %s\n", what, shown(got).c_str(), shown(expected).c_str());
+    return false;
+}
+template <typename Got, typename Expected>
+bool expect(const std::string &what, const Got &got, const Expected &expected) {
+    return expect(what.c_str(), got, expected);
+}
+
+inline int testResult() {
+    std::printf("%zu checks, %zu failures\n", testChecks, testFailures);
+    return testFailures ? 1 : 0;
+}
+
+#endif // AFS_TEST_COMMON_H
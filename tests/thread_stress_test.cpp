@@ -0,0 +1,79 @@
+/*
+ * Concurrent formatting against one instance while the adapter registry changes: readers
+ * format lines using labels, a format adapter and a nested funcAdapter while a writer
+ * keeps swapping the adapters. No thread may see a torn or stale-mixed result. Most
+ * useful in a -fsanitize=thread build (AFS_TSAN=ON).
+ *
+ *   g++ -std=c++17 -O2 -pthread -I.. thread_stress_test.cpp -o thread_stress_test
+ *   g++ -std=c++17 -O1 -g -pthread -fsanitize=thread -I.. thread_stress_test.cpp -o thread_stress_test_tsan
+ */
+#include "../AsulFormatString.h"
+#include "test_common.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+// Each installLabelAdapter call swaps (TAG), (OPEN) and (CLOSE) together and {STAR} is
+// swapped on its own, so a reader mixing two label snapshots matches no valid line.
+static bool validLine(const std::string &s, int i) {
+    std::string n = std::to_string(i);
+    for (const char *labels : {"<A> [", "<B> <"}) {
+        for (const char *star : {"*", "+"}) {
+            std::string expect = labels + n + (labels[1] == 'A' ? "]" : ">") + " #" + n + " " + star + n + star + "\n";
+            if (s == expect) return true;
+        }
+    }
+    return false;
+}
+
+static void stress(size_t readers, std::chrono::milliseconds duration) {
+    AsulFormatString afs;
+    afs.installFuncFormatAdapter({{"NUM", [&afs](const AsulFormatString::VariantType &v) {
+        // nested formatting on the same thread
+        return afs.f("#{}", std::get<int>(v));
+    }}});
+    auto publish = [&afs](bool a) {
+        afs.installLabelAdapter({{"TAG", a ? "<A>" : "<B>"}, {"OPEN", a ? "[" : "<"}, {"CLOSE", a ? "]" : ">"}});
+        afs.installFormatAdapter({{"STAR", a ? "*{}*" : "+{}+"}});
+    };
+    publish(true);
+
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> torn{0}, lines{0};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < readers; ++t) {
+        threads.emplace_back([&, t] {
+            std::string line;
+            for (int i = static_cast<int>(t); !stop.load(std::memory_order_relaxed); ++i) {
+                line.clear();
+                afs.f_append(line, "(TAG) (OPEN){}(CLOSE) {NUM} {STAR}[[ENDL]]", i, i, i);
+                if (!validLine(line, i)) {
+                    if (torn++ == 0) std::fprintf(stderr, "unexpected output: %s", line.c_str());
+                }
+                ++lines;
+            }
+        });
+    }
+    std::thread writer([&] {
+        for (bool a = false; !stop.load(std::memory_order_relaxed); a = !a) {
+            publish(a);
+            std::this_thread::yield();
+        }
+    });
+    std::this_thread::sleep_for(duration);
+    stop = true;
+    for (std::thread &th : threads) th.join();
+    writer.join();
+    std::printf("stress: %zu readers, %zu lines, %zu registry swaps\n",
+                readers, lines.load(), afs.formatCacheStats().invalidations);
+    expect("torn or stale-mixed lines", torn.load(), size_t(0));
+}
+
+int main(int argc, char **argv) {
+    size_t hw = std::thread::hardware_concurrency();
+    size_t readers = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : (hw ? hw : 4);
+    stress(readers < 2 ? 2 : readers, std::chrono::milliseconds(500));
+    return testResult();
+}
@@ -0,0 +1,77 @@
+/*
+ * installTypedFuncAdapter<T> given an argument of another type: try_f() / try_print()
+ * return a FormatIssue::Type naming the adapter instead of throwing, f() throws the same
+ * issue as a FormatError, and the adapter function is never called with the wrong type.
+ *
+ *   g++ -std=c++17 -O2 -pthread -I.. typed_adapter_test.cpp -o typed_adapter_test
+ */
+#include "../AsulFormatString.h"
+#include "test_common.h"
+
+struct Point { int x, y; };
+
+int main() {
+    AsulFormatString afs;
+    int calls = 0;
+    afs.installTypedFuncAdapter<int>("HEX", [&](int v) {
+        ++calls;
+        return afs.f("0x[[FILL:0]][[SETW:4]]{}", v);
+    });
+    afs.installTypedFuncAdapter<Point>("POINT", [&](const Point &p) {
+        ++calls;
+        return afs.f("({},{})", p.x, p.y);
+    });
+
+    auto good = afs.try_f("id {HEX} at {POINT}", 42, std::any(Point{1, 2}));
+    expect("matching types", good.value(), "id 0x0042 at (1,2)");
+    expect("matching types ok", good.ok(), true);
+
+    calls = 0;
+    auto wrong = afs.try_f("id {HEX} done", std::string("42"));
+    expect("try_f mismatch ok", wrong.ok(), false);
+    expect("try_f mismatch code", wrong.error().code, AsulFormatString::FormatIssue::Type);
+    expect("try_f mismatch token", wrong.error().token, "{HEX}");
+    expect("try_f mismatch offset", wrong.error().offset, size_t(3));
+    expect("try_f mismatch text", wrong.value(), "");
+    expect("adapter not called", calls, 0);
+
+    // a std::any holding something other than T
+    auto wrongAny = afs.try_f("{POINT}", std::any(3.5));
+    expect("any mismatch code", wrongAny.error().code, AsulFormatString::FormatIssue::Type);
+    expect("any mismatch token", wrongAny.error().token, "{POINT}");
+
+    // output written before the mismatch stays in the sink
+    std::string out;
+    AsulFormatString::StringSink sink(out);
+    AsulFormatString::FormatIssue issue = afs.try_print(sink, "{HEX} {HEX}", 7, 1.5);
+    expect("try_print mismatch code", issue.code, AsulFormatString::FormatIssue::Type);
+    expect("try_print mismatch token", issue.token, "{HEX}");
+    expect("try_print output before mismatch", out, "0x0007 ");
+
+    issue = afs.try_print("{HEX}", true);
+    expect("try_print to the print sink", issue.code, AsulFormatString::FormatIssue::Type);
+
+    AsulFormatString::FormatIssue::Code thrown = AsulFormatString::FormatIssue::None;
+    std::string token;
+    try {
+        afs.f("{HEX}", 'c');
+    } catch (const AsulFormatString::FormatError &e) {
+        thrown = e.code();
+        token = e.token();
+    }
+    expect("f() throws the mismatch", thrown, AsulFormatString::FormatIssue::Type);
+    expect("f() token", token, "{HEX}");
+
+    // reinstalling the key without a type drops the check
+    afs.installFuncFormatAdapter({{"HEX", [](const AsulFormatString::VariantType &v) {
+        return AsulFormatString::variantToString(v);
+    }}});
+    expect("untyped after reinstall", afs.try_f("{HEX}", std::string("42")).value(), "42");
+
+    // frozen registries carry the check too
+    afs.installTypedFuncAdapter<int>("NUM", [](int v) { return std::to_string(v); });
+    afs.freeze();
+    expect("frozen match", afs.try_f("{NUM}", 5).value(), "5");
+    expect("frozen mismatch", afs.try_f("{NUM}", 5.0).error().code, AsulFormatString::FormatIssue::Type);
+    return testResult();
+}
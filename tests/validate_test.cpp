@@ -0,0 +1,65 @@
+/*
+ * validate() byte offsets, tokens and issue codes: an unclosed [[, a stray ]], { and ( left
+ * open or crossed, escapes and ANSI sequences that are not errors, unknown and malformed
+ * directives, and each of these after multibyte UTF-8 text, where the offset counts bytes.
+ * f() must throw the same issue.
+ *
+ *   g++ -std=c++17 -O2 -pthread -I.. validate_test.cpp -o validate_test
+ */
+#include "../AsulFormatString.h"
+#include "test_common.h"
+
+using Issue = AsulFormatString::FormatIssue;
+
+static AsulFormatString afs;
+
+static const size_t npos = std::string::npos;
+
+static void check(const std::string &fmt, Issue::Code code, size_t offset, const std::string &token) {
+    Issue issue = afs.validate(fmt);
+    expect(fmt + ": code", issue.code, code);
+    expect(fmt + ": offset", issue.offset, offset);
+    expect(fmt + ": token", issue.token, token);
+    if (code == Issue::None) return;
+    std::string suffix = " (at byte " + std::to_string(offset) + ")";
+    expect(fmt + ": message ends with the offset",
+           issue.message.size() > suffix.size() && issue.message.compare(issue.message.size() - suffix.size(), npos, suffix) == 0, true);
+    Issue::Code thrown = Issue::None;
+    size_t thrownOffset = 0;
+    try {
+        afs.f(fmt, 1);
+    } catch (const AsulFormatString::FormatError &e) {
+        thrown = e.code();
+        thrownOffset = e.offset();
+    }
+    expect(fmt + ": f() throws it", thrown, code);
+    expect(fmt + ": f() offset", thrownOffset, offset);
+}
+
+int main() {
+    check("ab [[LEFT", Issue::Brackets, 3, "[[");
+    check("[[LEFT]] x [[SETW:3", Issue::Brackets, 11, "[[");
+    check("ab ]] cd", Issue::Brackets, 3, "]]");
+    check("[[LEFT]]]] x", Issue::Brackets, 8, "]]");
+    check("x {a", Issue::Brackets, 2, "{");
+    check("x {a {b}", Issue::Brackets, 2, "{");
+    check("x (a", Issue::Brackets, 2, "(");
+    check("{ ( }", Issue::Brackets, 2, "(");
+    check("( { )", Issue::Brackets, 2, "{");
+
+    // escapes, lone closers and ANSI sequences are fine
+    check("ok {{ (( ] ) }", Issue::None, npos, "");
+    check("\033[31m red \033[0m {}", Issue::None, npos, "");
+
+    check("[[]]", Issue::Directive, 0, "[[]]");
+    check("ab [[NOPE]]", Issue::Directive, 3, "[[NOPE]]");
+    check("a[[SETW:x]]", Issue::Directive, 1, "[[SETW:x]]");
+
+    // offsets count bytes: 你 and 好 are three bytes each, é two
+    check("\xE4\xBD\xA0\xE5\xA5\xBD [[SETW", Issue::Brackets, 7, "[[");
+    check("\xC3\xA9 ]]", Issue::Brackets, 3, "]]");
+    check("\xE6\x97\xA5\xE6\x9C\xAC {", Issue::Brackets, 7, "{");
+    check("\xF0\x9F\x98\x80(x", Issue::Brackets, 4, "(");
+    check("\xE4\xBD\xA0 [[NOPE]]", Issue::Directive, 4, "[[NOPE]]");
+    return testResult();
+}